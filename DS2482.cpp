@@ -9,15 +9,190 @@
 
 #include "DS2482.h"
 
+// Transport and clock used when none is passed to the constructor
+static DS2482WireBus defaultBus;
+static DS2482ArduinoClock defaultClock;
+
+// Channel selection codes and readback values from DS2482 datasheet
+static const uint8_t channelCodes[8] = {0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87};
+static const uint8_t readBackValues[8] = {0xB8, 0xB1, 0xAA, 0xA3, 0x9C, 0x95, 0x8E, 0x87};
+
+// Micro-programs of the DS18B20 operations
+const uint8_t DS2482_PROGRAM_CONVERT[] = {
+    DS2482_SEQ_SELECT, DS2482_SEQ_RESET,
+    DS2482_SEQ_WRITE | 2, 0xCC, 0x44,           // Skip ROM, Convert T
+    DS2482_SEQ_END
+};
+const uint8_t DS2482_PROGRAM_READ_TEMPERATURE[] = {
+    DS2482_SEQ_SELECT, DS2482_SEQ_RESET,
+    DS2482_SEQ_WRITE | 2, 0xCC, 0xBE,           // Skip ROM, Read Scratchpad
+    DS2482_SEQ_READ | 9,
+    DS2482_SEQ_END
+};
+const uint8_t DS2482_PROGRAM_READ_SCRATCHPAD[] = {  // On the selected channel
+    DS2482_SEQ_RESET,
+    DS2482_SEQ_WRITE | 2, 0xCC, 0xBE,
+    DS2482_SEQ_READ | 9,
+    DS2482_SEQ_END
+};
+
+/**
+ * Arms the call deadline for the duration of the outermost public call
+ * Public calls made from inside another one share its deadline. An aborted
+ * call may leave a 1-Wire command running or the channel unverified, so it
+ * always ends in ERROR state.
+ */
+struct DS2482::CallScope {
+    DS2482& driver;
+
+    CallScope(DS2482& driver) : driver(driver) {
+        if (driver.callDepth++ == 0) {
+            driver.callStart = driver.clock->millis();
+            driver.callAborted = false;
+        }
+    }
+    ~CallScope() {
+        if (--driver.callDepth == 0 && driver.callAborted) {
+            driver.currentState = DS2482State::ERROR;
+        }
+    }
+};
+
+/**
+ * Initialize the underlying TwoWire instance
+ */
+void DS2482WireBus::begin() {
+    wire.begin();
+}
+
+/**
+ * Write a complete transaction
+ * @param address 7-bit I2C address
+ * @param data Bytes to write
+ * @param length Number of bytes
+ * @return 0 on success, Wire endTransmission() error code otherwise
+ */
+uint8_t DS2482WireBus::write(uint8_t address, const uint8_t* data, uint8_t length) {
+    wire.beginTransmission(address);
+    wire.write(data, length);
+    return wire.endTransmission();
+}
+
+/**
+ * Free a slave that holds SDA low after an interrupted transaction
+ * Takes the pins over from Wire, clocks SCL until SDA is released (at most
+ * DS2482_BUS_CLEAR_CLOCKS pulses, enough to finish any byte in flight),
+ * generates a STOP and hands the pins back to Wire. Lines are driven open
+ * drain: low as OUTPUT, released as INPUT. Requires setBusPins().
+ * @return true if SDA was stuck low and is released now
+ */
+bool DS2482WireBus::clearBus() {
+    if (sdaPin == DS2482_NO_PIN || sclPin == DS2482_NO_PIN) {
+        return false;
+    }
+
+#if !defined(ARDUINO_ARCH_ESP8266)
+    wire.end();     // Release the pins from the I2C peripheral; ESP8266 Wire is bit-banged
+#endif
+    pinMode(sdaPin, INPUT);
+    pinMode(sclPin, INPUT);
+    delayMicroseconds(DS2482_BUS_CLEAR_HALF_US);
+
+    // An idle bus, or SCL held by a stretching slave, is nothing to clear
+    bool stuck = digitalRead(sdaPin) == LOW && digitalRead(sclPin) == HIGH;
+    if (stuck) {
+        for (uint8_t i = 0; i < DS2482_BUS_CLEAR_CLOCKS && digitalRead(sdaPin) == LOW; i++) {
+            digitalWrite(sclPin, LOW);
+            pinMode(sclPin, OUTPUT);
+            delayMicroseconds(DS2482_BUS_CLEAR_HALF_US);
+            pinMode(sclPin, INPUT);
+            delayMicroseconds(DS2482_BUS_CLEAR_HALF_US);
+        }
+
+        // STOP: SDA rises while SCL is high
+        digitalWrite(sdaPin, LOW);
+        pinMode(sdaPin, OUTPUT);
+        delayMicroseconds(DS2482_BUS_CLEAR_HALF_US);
+        pinMode(sdaPin, INPUT);
+        delayMicroseconds(DS2482_BUS_CLEAR_HALF_US);
+        stuck = digitalRead(sdaPin) == HIGH;
+    }
+
+    wire.begin();
+    return stuck;
+}
+
+/**
+ * Read a complete transaction
+ * @param address 7-bit I2C address
+ * @param data Buffer for received bytes
+ * @param length Number of bytes requested
+ * @return Number of bytes actually received
+ */
+uint8_t DS2482WireBus::read(uint8_t address, uint8_t* data, uint8_t length) {
+    wire.requestFrom(address, length);
+    uint8_t count = 0;
+    while (count < length && wire.available()) {
+        data[count++] = wire.read();
+    }
+    return count;
+}
+
+/**
+ * Busy wait on the Arduino core
+ * Split into steps, as delayMicroseconds() is only accurate up to 16383 us on AVR.
+ * @param us Microseconds to wait
+ */
+void DS2482ArduinoClock::delayMicroseconds(uint32_t us) {
+    while (us > 10000) {
+        ::delayMicroseconds(10000);
+        us -= 10000;
+    }
+    ::delayMicroseconds(us);
+}
+
 /**
  * Constructor - Initialize member variables
  * @param address I2C address of DS2482 (default 0x18)
+ * @param bus I2C transport, or nullptr to use the Wire library
+ * @param clock Time source, or nullptr to use millis() and micros()
  */
-DS2482::DS2482(uint8_t address) : 
+DS2482::DS2482(uint8_t address, DS2482Bus* bus, DS2482Clock* clock) : 
     address(address),
+    bus(bus ? bus : &defaultBus),
+    clock(clock ? clock : &defaultClock),
+    busStats(),
     currentState(DS2482State::IDLE),
-    conversionStartTime(0),
-    currentChannel(0) {}
+    convertingMask(0),
+    conversionChannel(0),
+    conversionStartMicros(0),
+    conversionFinishMicros(0),
+    conversionTime(DS2482_CONVERSION_TIME_MS),
+    currentChannel(0),
+    targetChannel(0),
+    config(0),
+    configApplied(false),
+    readPointer(DS2482_REG_UNKNOWN),
+    lastStatus(0),
+    deviceResets(0),
+    lastFrame(DS2482Frame::NONE),
+    histograms(nullptr),
+    energy(nullptr),
+    currents{DS2482_CURRENT_I2C_UA, DS2482_CURRENT_1W_UA, DS2482_CURRENT_CONVERSION_UA, DS2482_CURRENT_PULLUP_UA},
+    romPhase(0),
+    callTimeout(0),
+    callStart(0),
+    callDepth(0),
+    callAborted(false),
+    abortCount(0),
+    wirePending(false),
+    wireIssueTime(0),
+    wireNominal(0) {
+    for (uint8_t i = 0; i < 8; i++) {
+        conversionStarts[i] = 0;
+    }
+    resetRecoveryCounts();
+}
 
 /**
  * Initialize the DS2482 device
@@ -25,13 +200,20 @@ DS2482::DS2482(uint8_t address) :
  * @return true if initialization successful, false on any error
  */
 bool DS2482::begin() {
-    Wire.begin();
+    CallScope scope(*this);
+    bus->begin();
     DEBUG_PRINTLN("Initializing DS2482...");
     
     if (!reset()) {
         DEBUG_PRINTLN("Reset failed");
         return false;
     }
+
+    // Clears RST, so a later RST in the status means the bridge reset itself
+    if (!writeConfig(config)) {
+        DEBUG_PRINTLN("Configuration failed");
+        return false;
+    }
     
     if (!wakeUp()) {
         DEBUG_PRINTLN("Wake up failed");
@@ -39,7 +221,7 @@ bool DS2482::begin() {
     }
 
     uint8_t status = readStatus();
-    if (status == 0x18) {
+    if (status == DS2482_STATUS_LL) {
         DEBUG_PRINTLN("DS2482-800 Initialized Successfully");
         currentState = DS2482State::IDLE;
         return true;
@@ -51,25 +233,108 @@ bool DS2482::begin() {
     }
 }
 
+/**
+ * Resume after MCU sleep without a full begin()
+ * If the bridge stayed powered, it still holds the channel and configuration
+ * in the driver's shadow, and a single status read proves it: RST clear
+ * means no reset since the configuration was written, 1WB clear means no
+ * 1-Wire command is running. The channel is then not selected again and the
+ * first conversion starts right away. RST set means the bridge was powered
+ * up in the meantime and is in its reset state; writing the configuration is
+ * enough. Anything else falls back to begin().
+ * @return Path taken, DS2482Start::FAILED if the bridge is not usable
+ */
+DS2482Start DS2482::warmStart() {
+    CallScope scope(*this);
+    DEBUG_PRINTLN("Warm start DS2482");
+    bus->begin();
+
+    if (configApplied) {
+        configApplied = false;  // RST after a power-down is expected, not a brownout
+        uint8_t status = readStatus();
+        if (!(status & (DS2482_STATUS_RST | DS2482_STATUS_1WB))) {
+            configApplied = true;
+            currentState = DS2482State::IDLE;
+            return DS2482Start::WARM;
+        }
+        if (!(status & DS2482_STATUS_1WB)) {
+            // Power-up selects IO0, but a select may have followed the reset
+            // before any status read showed RST
+            currentChannel = DS2482_CHANNEL_UNKNOWN;
+            if (writeConfig(config)) {
+                currentState = DS2482State::IDLE;
+                return DS2482Start::POWER_UP;
+            }
+        }
+    }
+
+    return begin() ? DS2482Start::FULL : DS2482Start::FAILED;
+}
+
+/**
+ * Resume after MCU sleep from a state saved before it
+ * For boards that lose RAM in deep sleep: keep the DS2482Shadow in memory
+ * that survives it. A shadow that is not valid (zeroed memory after a cold
+ * boot) leads to begin().
+ * @param shadow State returned by getShadow() before the sleep
+ * @return Path taken, DS2482Start::FAILED if the bridge is not usable
+ */
+DS2482Start DS2482::warmStart(const DS2482Shadow& shadow) {
+    config = shadow.config & 0x0F;
+    currentChannel = shadow.channel > 7 ? DS2482_CHANNEL_UNKNOWN : shadow.channel;
+    if (currentChannel != DS2482_CHANNEL_UNKNOWN) {
+        targetChannel = currentChannel;
+    }
+    readPointer = shadow.readPointer;
+    configApplied = shadow.valid;
+    return warmStart();
+}
+
+/**
+ * State to keep across MCU sleep for warmStart()
+ * Take it after the last bus access before the sleep.
+ * @return Configuration, channel and read pointer as the driver tracks them
+ */
+DS2482Shadow DS2482::getShadow() {
+    DS2482Shadow shadow;
+    shadow.config = config;
+    shadow.channel = currentChannel;
+    shadow.readPointer = readPointer;
+    shadow.valid = configApplied;
+    return shadow;
+}
+
 /**
  * Reset the DS2482 with timeout checking
  * Non-blocking implementation that polls for completion
  * @return true if reset successful, false on timeout or error
  */
 bool DS2482::reset() {
+    CallScope scope(*this);
     DEBUG_PRINTLN("Resetting DS2482");
-    writeCommand(DS2482_CMD_RESET);
+    if (!writeCommand(DS2482_CMD_RESET)) {
+        // RST may still be set from an earlier reset; do not trust it
+        currentState = DS2482State::ERROR;
+        currentChannel = DS2482_CHANNEL_UNKNOWN;
+        return false;
+    }
+    configApplied = false;  // RST is expected from here on
     
-    unsigned long startTime = millis();
-    while (millis() - startTime < 100) {  // 100ms timeout
+    uint32_t start = clock->micros();
+    unsigned long startTime = clock->millis();
+    unsigned long limit = waitLimit();
+    while (clock->millis() - startTime < limit) {
         uint8_t status = readStatus();
         if (status & DS2482_STATUS_RST) {
             currentState = DS2482State::IDLE;
+            currentChannel = 0;   // Device reset selects IO0
             return true;
         }
-        delayMicroseconds(100);  // Short delay between checks
+        clock->delayMicroseconds(DS2482_POLL_INTERVAL_US);  // Short delay between checks
     }
+    recordLatency(DS2482Op::TIMEOUT, start);
     currentState = DS2482State::ERROR;
+    currentChannel = DS2482_CHANNEL_UNKNOWN;
     return false;
 }
 
@@ -78,17 +343,23 @@ bool DS2482::reset() {
  * @return true if device responds and becomes ready
  */
 bool DS2482::wakeUp() {
+    CallScope scope(*this);
     DEBUG_PRINTLN("Waking up DS2482");
-    writeCommand(DS2482_CMD_READ_BYTE);
+    if (!writeCommand(DS2482_CMD_READ_BYTE)) {
+        return false;
+    }
     
-    unsigned long startTime = millis();
-    while (millis() - startTime < 100) {  // 100ms timeout
+    uint32_t start = clock->micros();
+    unsigned long startTime = clock->millis();
+    unsigned long limit = waitLimit();
+    while (clock->millis() - startTime < limit) {
         uint8_t status = readStatus();
         if (!(status & DS2482_STATUS_1WB)) {  // Check if 1-Wire Busy bit is clear
             return true;
         }
-        delayMicroseconds(100);
+        clock->delayMicroseconds(DS2482_POLL_INTERVAL_US);
     }
+    recordLatency(DS2482Op::TIMEOUT, start);
     return false;
 }
 
@@ -97,63 +368,105 @@ bool DS2482::wakeUp() {
  * @return Status register value or 0xFF on error
  */
 uint8_t DS2482::readStatus() {
-    setReadPointer(0xF0);
-    Wire.requestFrom(address, (uint8_t)1);
-    return Wire.available() ? Wire.read() : 0xFF;
+    setReadPointer(DS2482_REG_STATUS);
+    uint8_t status;
+    if (!i2cRead(&status)) {
+        return 0xFF;
+    }
+    lastStatus = status;
+    if (!(status & DS2482_STATUS_1WB)) {
+        finishWire(clock->micros() - wireIssueTime);
+    }
+    if ((status & DS2482_STATUS_RST) && configApplied) {
+        // Configuration written since the last reset, yet RST is set again:
+        // the bridge reset on its own (brownout) and lost channel and config
+        DEBUG_PRINTLN("Unexpected device reset");
+        configApplied = false;
+        currentChannel = DS2482_CHANNEL_UNKNOWN;
+        if (deviceResets < 0xFFFF) {
+            deviceResets++;
+        }
+    }
+    return status;
 }
 
 /**
  * Select a specific 1-Wire channel
- * Includes verification of channel selection success
+ * Includes verification of channel selection success. An already selected
+ * channel costs no transaction: only a 1-Wire command that may still run is
+ * waited for, and if those status polls show the bridge has reset, the
+ * configuration is written again and the channel selected anew.
  * @param channel Channel number (0-7)
  * @return true if channel selected and verified
  */
 bool DS2482::selectChannel(uint8_t channel) {
+    CallScope scope(*this);
     if (channel > 7) {
         DEBUG_PRINTLN("Invalid channel number");
         return false;
     }
 
-    // Channel selection codes from DS2482 datasheet
-    static const uint8_t channelCodes[8] = {0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87};
-    static const uint8_t readBackValues[8] = {0xB8, 0xB1, 0xAA, 0xA3, 0x9C, 0x95, 0x8E, 0x87};
-
     DEBUG_PRINT("Selecting channel ");
     DEBUG_PRINTLN(channel);
     
-    Wire.beginTransmission(address);
-    Wire.write(DS2482_CMD_CHANNEL_SELECT);
-    Wire.write(channelCodes[channel]);
-    
-    if (Wire.endTransmission() != 0) {
+    uint32_t start = clock->micros();
+    targetChannel = channel;
+
+    // The bridge NACKs a channel select while 1WB is set
+    if (!waitIfWirePending()) {
+        DEBUG_PRINTLN("1-Wire bus busy during channel select");
+        currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::SELECT_CHANNEL, start);
+        return false;
+    }
+
+    // Any status read since the configuration was written would have shown a
+    // reset; an already selected channel needs nothing more
+    if (channel == currentChannel && configApplied) {
+        recordLatency(DS2482Op::SELECT_CHANNEL, start);
+        return true;
+    }
+
+    // Restore the configuration a device reset cleared
+    if (!configApplied && !writeConfig(config)) {
+        recordLatency(DS2482Op::SELECT_CHANNEL, start);
+        return false;
+    }
+
+    // Until the readback confirms it, the selected channel is not known
+    currentChannel = DS2482_CHANNEL_UNKNOWN;
+
+    uint8_t command[2] = {DS2482_CMD_CHANNEL_SELECT, channelCodes[channel]};
+    if (!i2cWrite(command, 2)) {
         DEBUG_PRINTLN("Channel selection command failed");
         currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::SELECT_CHANNEL, start);
         return false;
     }
 
-    delayMicroseconds(100);  // Required by DS2482 specification
+    clock->delayMicroseconds(DS2482_CHANNEL_SETTLE_US);  // Required by DS2482 specification
 
     setReadPointer(DS2482_CHANNEL_READBACK);
-    Wire.requestFrom(address, (uint8_t)1);
-    
-    if (!Wire.available()) {
+    uint8_t readBack;
+    if (!i2cRead(&readBack)) {
         DEBUG_PRINTLN("No response during channel verification");
         currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::SELECT_CHANNEL, start);
         return false;
     }
 
-    uint8_t readBack = Wire.read();
-    currentChannel = channel;
-
     DEBUG_PRINT("Expected readback: 0x");
     DEBUG_PRINT_HEX(readBackValues[channel]);
     DEBUG_PRINT(" Got: 0x");
     DEBUG_PRINTLN_HEX(readBack);
 
     bool success = (readBack == readBackValues[channel]);
-    if (!success) {
+    if (success) {
+        currentChannel = channel;
+    } else {
         currentState = DS2482State::ERROR;
     }
+    recordLatency(DS2482Op::SELECT_CHANNEL, start);
     return success;
 }
 
@@ -171,12 +484,43 @@ void DS2482::printStatus() {
  * @return true if device presence detected
  */
 bool DS2482::wireReset() {
+    CallScope scope(*this);
     DEBUG_PRINTLN("Performing 1-Wire reset");
-    writeCommand(DS2482_CMD_WIRE_RESET);
+    uint32_t start = clock->micros();
+    uint16_t resets = deviceResets;
+    bool retried = false;
+    if (!waitIfWirePending()) {
+        DEBUG_PRINTLN("1-Wire bus busy before reset");
+        currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::WIRE_RESET, start);
+        return false;
+    }
+    if (!writeCommand(DS2482_CMD_WIRE_RESET)) {
+        // PPD would still hold the result of the previous reset
+        DEBUG_PRINTLN("1-Wire reset command failed");
+        currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::WIRE_RESET, start);
+        return false;
+    }
     
-    unsigned long startTime = millis();
-    while (millis() - startTime < 100) {  // 100ms timeout
+    unsigned long startTime = clock->millis();
+    unsigned long limit = waitLimit();
+    while (clock->millis() - startTime < limit) {
         uint8_t status = readStatus();
+        if (deviceResets != resets) {
+            // Bridge reset under us: the pulse went to IO0. A select skips
+            // the status read, so this is often where the reset shows; select
+            // the channel again and repeat the pulse once.
+            if (retried || !selectChannel(targetChannel) ||
+                !writeCommand(DS2482_CMD_WIRE_RESET)) {
+                currentState = DS2482State::ERROR;
+                recordLatency(DS2482Op::WIRE_RESET, start);
+                return false;
+            }
+            retried = true;
+            resets = deviceResets;
+            continue;
+        }
         if (!(status & DS2482_STATUS_1WB)) {
             bool presenceDetected = (status & DS2482_STATUS_PPD) != 0;
             DEBUG_PRINT("Wire reset result: ");
@@ -185,30 +529,50 @@ bool DS2482::wireReset() {
             if (!presenceDetected) {
                 currentState = DS2482State::ERROR;
             }
+            recordLatency(DS2482Op::WIRE_RESET, start);
             return presenceDetected;
         }
-        delayMicroseconds(100);
+        clock->delayMicroseconds(DS2482_POLL_INTERVAL_US);
     }
     
+    recordLatency(DS2482Op::WIRE_RESET, start);
+    recordLatency(DS2482Op::TIMEOUT, start);
     currentState = DS2482State::ERROR;
     return false;
 }
 
+/**
+ * Issue a 1-Wire reset and return immediately
+ * Use waitFor1Wire() with a status pointer to collect the presence result
+ * (DS2482_STATUS_PPD). Lets the caller start resets on several bridges
+ * before waiting on any of them.
+ * @return true if the bridge accepted the command
+ */
+bool DS2482::startWireReset() {
+    CallScope scope(*this);
+    if (!waitIfWirePending()) {
+        DEBUG_PRINTLN("1-Wire bus busy before reset");
+        currentState = DS2482State::ERROR;
+        return false;
+    }
+    uint8_t command = DS2482_CMD_WIRE_RESET;
+    return i2cWrite(&command, 1);
+}
+
 /**
  * Write a single bit to the 1-Wire bus
  * @param bit Bit value to write (0 or 1)
  */
 void DS2482::wireWriteBit(uint8_t bit) {
-    if (!waitFor1Wire()) {
+    CallScope scope(*this);
+    if (!waitIfWirePending()) {
         DEBUG_PRINTLN("1-Wire bus busy during bit write");
         currentState = DS2482State::ERROR;
         return;
     }
     
-    Wire.beginTransmission(address);
-    Wire.write(DS2482_CMD_SINGLE_BIT);
-    Wire.write(bit ? 0x80 : 0x00);
-    Wire.endTransmission();
+    uint8_t command[2] = {DS2482_CMD_SINGLE_BIT, (uint8_t)(bit ? 0x80 : 0x00)};
+    i2cWrite(command, 2);
 }
 
 /**
@@ -216,41 +580,53 @@ void DS2482::wireWriteBit(uint8_t bit) {
  * @return Bit value read (0 or 1), or 0 on error
  */
 uint8_t DS2482::wireReadBit() {
-    if (!waitFor1Wire()) {
+    CallScope scope(*this);
+    if (!waitIfWirePending()) {
         DEBUG_PRINTLN("1-Wire bus busy during bit read");
         currentState = DS2482State::ERROR;
         return 0;
     }
     
-    Wire.beginTransmission(address);
-    Wire.write(DS2482_CMD_SINGLE_BIT);
-    Wire.write(0x80);
-    Wire.endTransmission();
+    uint8_t command[2] = {DS2482_CMD_SINGLE_BIT, 0x80};
+    i2cWrite(command, 2);
 
-    if (!waitFor1Wire()) {
+    // The poll that sees 1WB clear already carries the result
+    uint8_t status;
+    if (!waitFor1Wire(&status)) {
         DEBUG_PRINTLN("Bit read timeout");
         currentState = DS2482State::ERROR;
         return 0;
     }
 
-    return (readStatus() & DS2482_STATUS_SBR) ? 1 : 0;
+    return (status & DS2482_STATUS_SBR) ? 1 : 0;
 }
 
 /**
  * Write a byte to the 1-Wire bus
+ * The bridge shifts the byte out after the call returns; a later command
+ * waits for it.
  * @param byte Byte value to write
+ * @return true if the bridge acknowledged the command, false (and ERROR
+ *         state) if it was busy or NACKed it
  */
-void DS2482::wireWriteByte(uint8_t byte) {
-    if (!waitFor1Wire()) {
+bool DS2482::wireWriteByte(uint8_t byte) {
+    CallScope scope(*this);
+    uint32_t start = clock->micros();
+    if (!waitIfWirePending()) {
         DEBUG_PRINTLN("1-Wire bus busy during byte write");
         currentState = DS2482State::ERROR;
-        return;
+        recordLatency(DS2482Op::WIRE_WRITE_BYTE, start);
+        return false;
     }
     
-    Wire.beginTransmission(address);
-    Wire.write(DS2482_CMD_WRITE_BYTE);
-    Wire.write(byte);
-    Wire.endTransmission();
+    uint8_t command[2] = {DS2482_CMD_WRITE_BYTE, byte};
+    bool ok = i2cWrite(command, 2);
+    if (!ok) {
+        DEBUG_PRINTLN("Write byte command failed");
+        currentState = DS2482State::ERROR;
+    }
+    recordLatency(DS2482Op::WIRE_WRITE_BYTE, start);
+    return ok;
 }
 
 /**
@@ -258,27 +634,41 @@ void DS2482::wireWriteByte(uint8_t byte) {
  * @return Byte value read, or 0xFF on error
  */
 uint8_t DS2482::wireReadByte() {
-    if (!waitFor1Wire()) {
+    CallScope scope(*this);
+    uint32_t start = clock->micros();
+    if (!waitIfWirePending()) {
         DEBUG_PRINTLN("1-Wire bus busy during byte read");
         currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::WIRE_READ_BYTE, start);
         return 0xFF;
     }
     
-    writeCommand(DS2482_CMD_READ_BYTE);
+    if (!writeCommand(DS2482_CMD_READ_BYTE)) {
+        DEBUG_PRINTLN("Read byte command failed");
+        currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::WIRE_READ_BYTE, start);
+        return 0xFF;
+    }
     
     if (!waitFor1Wire()) {
         DEBUG_PRINTLN("Read operation timeout");
         currentState = DS2482State::ERROR;
+        recordLatency(DS2482Op::WIRE_READ_BYTE, start);
         return 0xFF;
     }
 
-    setReadPointer(0xE1);
-    Wire.requestFrom(address, (uint8_t)1);
-    uint8_t value = Wire.available() ? Wire.read() : 0xFF;
+    setReadPointer(DS2482_REG_DATA);
+    uint8_t value;
+    if (!i2cRead(&value)) {
+        DEBUG_PRINTLN("No data byte received");
+        currentState = DS2482State::ERROR;
+        value = 0xFF;
+    }
     
     DEBUG_PRINT("Read byte: 0x");
     DEBUG_PRINTLN_HEX(value);
     
+    recordLatency(DS2482Op::WIRE_READ_BYTE, start);
     return value;
 }
 
@@ -288,25 +678,22 @@ uint8_t DS2482::wireReadByte() {
  * @return true if conversion started successfully
  */
 bool DS2482::startTemperatureConversion(uint8_t channel) {
+    CallScope scope(*this);
     DEBUG_PRINT("Starting temperature conversion on channel ");
     DEBUG_PRINTLN(channel);
     
     currentState = DS2482State::IDLE;
     
-    if (!selectChannel(channel)) {
-        DEBUG_PRINTLN("Failed to select channel for conversion");
-        return false;
-    }
-
-    if (!beginTemperatureOperation()) {
-        DEBUG_PRINTLN("Failed to begin temperature operation");
+    if (!runProgram(DS2482_PROGRAM_CONVERT, channel)) {
+        DEBUG_PRINTLN("Failed to start conversion");
         return false;
     }
 
-    wireWriteByte(0xCC); // Skip ROM
-    wireWriteByte(0x44); // Convert T
-    
-    conversionStartTime = millis();
+    // The sensor samples from here on, not when the scratchpad is read
+    conversionStartMicros = clock->micros();
+    conversionStarts[channel] = clock->millis();
+    convertingMask |= 1 << channel;
+    conversionChannel = channel;
     currentState = DS2482State::CONVERTING_TEMPERATURE;
     DEBUG_PRINTLN("Conversion started successfully");
     return true;
@@ -321,8 +708,9 @@ bool DS2482::checkConversionStatus() {
         return false;
     }
 
-    if (millis() - conversionStartTime >= 750) {  // DS18B20 conversion time
+    if (clock->millis() - conversionStarts[conversionChannel] >= conversionTime) {
         DEBUG_PRINTLN("Temperature conversion complete");
+        conversionFinishMicros = clock->micros();
         currentState = DS2482State::IDLE;
         return true;
     }
@@ -330,6 +718,68 @@ bool DS2482::checkConversionStatus() {
     return false;
 }
 
+/**
+ * Check whether a channel's last conversion has had its conversion time
+ * Works for every conversion the driver saw go out, including those of
+ * DS2482Snapshot, and does not touch the driver state.
+ * @param channel Channel number (0-7)
+ * @return true if no conversion is running on the channel
+ */
+bool DS2482::checkConversionStatus(uint8_t channel) {
+    if (channel > 7) {
+        return true;
+    }
+    return !(getConvertingChannels() & (1 << channel));
+}
+
+/**
+ * Completion time of a channel's last conversion
+ * @param channel Channel number (0-7)
+ * @return millis() at which the conversion time has passed
+ */
+unsigned long DS2482::getConversionDue(uint8_t channel) {
+    if (channel > 7) {
+        return clock->millis();
+    }
+    return conversionStarts[channel] + conversionTime;
+}
+
+/**
+ * Channels that are still converting
+ * @return Bit n set while channel n's conversion time has not passed
+ */
+uint8_t DS2482::getConvertingChannels() {
+    unsigned long now = clock->millis();
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        if ((convertingMask & (1 << channel)) &&
+            now - conversionStarts[channel] >= conversionTime) {
+            convertingMask &= ~(1 << channel);
+        }
+    }
+    return convertingMask;
+}
+
+/**
+ * Earliest completion among the channels still converting
+ * @param due Receives the millis() of that completion
+ * @return false if no channel is converting
+ */
+bool DS2482::nextConversionDue(unsigned long* due) {
+    uint8_t converting = getConvertingChannels();
+    bool found = false;
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        if (!(converting & (1 << channel))) {
+            continue;
+        }
+        unsigned long at = getConversionDue(channel);
+        if (!found || (long)(at - *due) < 0) {
+            *due = at;
+            found = true;
+        }
+    }
+    return found;
+}
+
 /**
  * Read temperature from specified channel
  * @param channel Channel number (0-7)
@@ -337,40 +787,66 @@ bool DS2482::checkConversionStatus() {
  * @return true if temperature read successfully
  */
 bool DS2482::readTemperature(uint8_t channel, float* temperature) {
+    CallScope scope(*this);
+    int16_t raw;
+    if (!readTemperatureRaw(channel, &raw)) {
+        return false;
+    }
+    *temperature = raw / 16.0;
+    
+    DEBUG_PRINT("Temperature: ");
+    DEBUG_PRINT(*temperature);
+    DEBUG_PRINTLN(" °C");
+    return true;
+}
+
+/**
+ * Read raw temperature from specified channel
+ * The scratchpad is validated before use. Power-on (85.00 °C), all-0xFF,
+ * all-0x00 and CRC-failed frames return false without putting the driver
+ * into ERROR state; getLastFrame() tells which check failed. The decoded
+ * value is still stored in raw for frames that were read. A transaction
+ * that failed during the read is a bus fault, not a sensor fault: the
+ * frame is DS2482Frame::BUS_ERROR and the driver stays in ERROR state.
+ * @param channel Channel number (0-7)
+ * @param raw Pointer to store temperature in 1/16 °C units
+ * @return true if a valid temperature was read
+ */
+bool DS2482::readTemperatureRaw(uint8_t channel, int16_t* raw) {
+    CallScope scope(*this);
     DEBUG_PRINT("Reading temperature from channel ");
     DEBUG_PRINTLN(channel);
     
+    uint32_t start = clock->micros();
     currentState = DS2482State::IDLE;
+    lastFrame = DS2482Frame::NONE;
     
-    if (!selectChannel(channel)) {
-        DEBUG_PRINTLN("Failed to select channel for reading");
-        return false;
-    }
-
-    if (!beginTemperatureOperation()) {
-        DEBUG_PRINTLN("Failed to begin temperature operation");
+    uint8_t scratchpad[9];
+    DS2482Program run;
+    startProgram(run, DS2482_PROGRAM_READ_TEMPERATURE, channel, scratchpad);
+    if (!runProgram(run)) {
+        DEBUG_PRINTLN("Failed to read scratchpad");
+        if (!callAborted && (run.opcode == DS2482_SEQ_WRITE || run.opcode == DS2482_SEQ_READ)) {
+            lastFrame = DS2482Frame::BUS_ERROR;     // Cut short by the bus, not the sensor
+        }
+        recordLatency(DS2482Op::ACQUISITION, start);
         return false;
     }
 
-    uint8_t scratchpad[9];
-    wireWriteByte(0xCC); // Skip ROM
-    wireWriteByte(0xBE); // Read Scratchpad
-    
-    DEBUG_PRINTLN("Reading scratchpad");
-    for (int i = 0; i < 9; i++) {
-        scratchpad[i] = wireReadByte();
-    }
-    
     printScratchpad(scratchpad);
     
-    int16_t raw = (scratchpad[1] << 8) | scratchpad[0];
-    *temperature = raw / 16.0;
-    
-    DEBUG_PRINT("Temperature: ");
-    DEBUG_PRINT(*temperature);
-    DEBUG_PRINTLN(" °C");
+    *raw = (scratchpad[1] << 8) | scratchpad[0];
+    lastFrame = checkScratchpad(scratchpad);
+    recordLatency(DS2482Op::ACQUISITION, start);
     
-    currentState = DS2482State::IDLE;
+    if (lastFrame != DS2482Frame::VALID) {
+        DEBUG_PRINT("Invalid scratchpad frame: ");
+        DEBUG_PRINTLN((uint8_t)lastFrame);
+        return false;
+    }
+    if (energy) {
+        energy[channel].samples++;
+    }
     return true;
 }
 
@@ -380,18 +856,225 @@ bool DS2482::readTemperature(uint8_t channel, float* temperature) {
  * @return true if scratchpad read successfully
  */
 bool DS2482::readScratchpad(uint8_t* scratchpad) {
-    if (!beginTemperatureOperation()) {
-        return false;
+    return runProgram(DS2482_PROGRAM_READ_SCRATCHPAD, currentChannel, scratchpad);
+}
+
+/**
+ * Run a 1-Wire micro-program to its end
+ * Programs are DS2482_SEQ_* opcodes, e.g. DS2482_PROGRAM_CONVERT; the whole
+ * program shares one call deadline.
+ * @param program Bytecode ending in DS2482_SEQ_END
+ * @param channel Channel for DS2482_SEQ_SELECT (0-7)
+ * @param data Buffer for the bytes of DS2482_SEQ_READ, nullptr to discard them
+ * @return true if every step succeeded
+ */
+bool DS2482::runProgram(const uint8_t* program, uint8_t channel, uint8_t* data) {
+    CallScope scope(*this);
+    DS2482Program run;
+    startProgram(run, program, channel, data);
+    return runProgram(run);
+}
+
+/**
+ * Step a started micro-program to its end, polling a busy bridge at
+ * DS2482_POLL_INTERVAL_US like waitFor1Wire()
+ * @param run Program started with startProgram()
+ * @return true if every step succeeded
+ */
+bool DS2482::runProgram(DS2482Program& run) {
+    CallScope scope(*this);
+    DS2482ProgramStatus status;
+    while ((status = stepProgram(run)) == DS2482ProgramStatus::RUNNING) {
+        if (run.waiting) {
+            clock->delayMicroseconds(DS2482_POLL_INTERVAL_US);
+        }
     }
-    
-    wireWriteByte(0xCC); // Skip ROM
-    wireWriteByte(0xBE); // Read Scratchpad
-    
-    for (int i = 0; i < 9; i++) {
-        scratchpad[i] = wireReadByte();
+    return status == DS2482ProgramStatus::DONE;
+}
+
+/**
+ * Start a 1-Wire micro-program without running any of it
+ * stepProgram() then runs it a little per call, so the programs of several
+ * bridges can be interleaved. All progress is kept in
+ * run, so other calls on the driver may come between the steps; they must
+ * not leave a 1-Wire command running or select another channel.
+ * @param run Progress of the program, owned by the caller
+ * @param program Bytecode ending in DS2482_SEQ_END
+ * @param channel Channel for DS2482_SEQ_SELECT (0-7)
+ * @param data Buffer for the bytes of DS2482_SEQ_READ, nullptr to discard them
+ */
+void DS2482::startProgram(DS2482Program& run, const uint8_t* program, uint8_t channel, uint8_t* data) {
+    run.code = program;
+    run.data = data;
+    run.channel = channel;
+    run.counter = 0;
+    run.opcode = DS2482_SEQ_END;
+    run.remaining = 0;
+    run.issued = false;
+    run.waiting = false;
+    run.retried = false;
+    run.resets = 0;
+    run.opStart = 0;
+    run.waitStart = 0;
+}
+
+/**
+ * Run the next step of a started micro-program
+ * A step issues one operation - a channel select, a 1-Wire reset or one
+ * byte written or read - or polls the status once for the result of one.
+ * While the bridge is busy the step returns RUNNING at once; the caller
+ * calls again, best after DS2482_POLL_INTERVAL_US. The DS2482_SEQ_SELECT
+ * step is the exception: it is a whole selectChannel(), with the select
+ * and readback transactions, the channel settle delay and, after a bridge
+ * reset, the configuration write, so it blocks for those. The program ends in
+ * ERROR state at the first operation that is not acknowledged, finds no
+ * presence pulse or stays busy past DS2482_TIMEOUT_MS.
+ * @param run Program started with startProgram()
+ * @return RUNNING while steps remain, DONE at the end, FAILED on an error
+ */
+DS2482ProgramStatus DS2482::stepProgram(DS2482Program& run) {
+    CallScope scope(*this);
+    if (!run.code) {
+        return DS2482ProgramStatus::FAILED;
     }
-    
-    return true;
+
+    if (!run.issued) {
+        if (run.remaining == 0) {
+            uint8_t op = run.code[run.counter++];
+            run.opcode = op & DS2482_SEQ_OPCODE_MASK;
+            run.remaining = op & DS2482_SEQ_COUNT_MASK;
+            switch (run.opcode) {
+                case DS2482_SEQ_END:
+                    run.code = nullptr;
+                    return DS2482ProgramStatus::DONE;
+                case DS2482_SEQ_SELECT:
+                case DS2482_SEQ_RESET:
+                    run.remaining = 1;
+                    break;
+                case DS2482_SEQ_WRITE:
+                case DS2482_SEQ_READ:
+                    if (run.remaining == 0) {
+                        return DS2482ProgramStatus::RUNNING;
+                    }
+                    break;
+                default:
+                    DEBUG_PRINTLN("Invalid micro-program opcode");
+                    return failProgram(run);
+            }
+        }
+        if (!run.waiting) {
+            run.opStart = clock->micros();
+        }
+
+        // The bridge NACKs commands while an earlier write still shifts out
+        if (wirePending && (readStatus() & DS2482_STATUS_1WB)) {
+            return waitProgram(run);
+        }
+        run.waiting = false;
+
+        bool ok = false;
+        switch (run.opcode) {
+            case DS2482_SEQ_SELECT:
+                ok = selectChannel(run.channel);
+                break;
+            case DS2482_SEQ_RESET:
+                run.resets = deviceResets;
+                ok = run.issued = writeCommand(DS2482_CMD_WIRE_RESET);
+                break;
+            case DS2482_SEQ_WRITE:
+                ok = wireWriteByte(run.code[run.counter++]);
+                break;
+            case DS2482_SEQ_READ:
+                ok = run.issued = writeCommand(DS2482_CMD_READ_BYTE);
+                break;
+        }
+        if (!ok) {
+            DEBUG_PRINTLN("Micro-program step failed");
+            return failProgram(run);
+        }
+        if (!run.issued) {
+            run.remaining--;
+            return DS2482ProgramStatus::RUNNING;
+        }
+    }
+
+    // Poll once for the result of the reset or read byte
+    uint8_t status = readStatus();
+    if (run.opcode == DS2482_SEQ_RESET && deviceResets != run.resets) {
+        // Bridge reset under us: the pulse went to IO0; select the channel
+        // again and repeat the pulse once, as wireReset() does
+        if (run.retried || !selectChannel(targetChannel) ||
+            !writeCommand(DS2482_CMD_WIRE_RESET)) {
+            return failProgram(run);
+        }
+        run.retried = true;
+        run.resets = deviceResets;
+        return DS2482ProgramStatus::RUNNING;
+    }
+    if (status & DS2482_STATUS_1WB) {
+        return waitProgram(run);
+    }
+    run.waiting = false;
+    run.issued = false;
+
+    if (run.opcode == DS2482_SEQ_RESET) {
+        if (!(status & DS2482_STATUS_PPD)) {
+            DEBUG_PRINTLN("1-Wire reset failed, no device detected");
+            return failProgram(run);
+        }
+        recordLatency(DS2482Op::WIRE_RESET, run.opStart);
+    } else {
+        setReadPointer(DS2482_REG_DATA);
+        uint8_t value;
+        if (!i2cRead(&value)) {
+            DEBUG_PRINTLN("No data byte received");
+            return failProgram(run);
+        }
+        if (run.data) {
+            *run.data++ = value;
+        }
+        recordLatency(DS2482Op::WIRE_READ_BYTE, run.opStart);
+    }
+    run.remaining--;
+    return DS2482ProgramStatus::RUNNING;
+}
+
+/**
+ * Note a busy poll of a micro-program
+ * @param run Program in progress
+ * @return RUNNING, or FAILED once the bridge has been busy for the wait limit
+ */
+DS2482ProgramStatus DS2482::waitProgram(DS2482Program& run) {
+    uint32_t now = clock->micros();
+    if (!run.waiting) {
+        run.waiting = true;
+        run.waitStart = now;
+    }
+    if (now - run.waitStart < waitLimit() * 1000UL) {
+        return DS2482ProgramStatus::RUNNING;
+    }
+    DEBUG_PRINTLN("1-Wire bus busy during micro-program");
+    recordLatency(DS2482Op::TIMEOUT, run.waitStart);
+    return failProgram(run);
+}
+
+/**
+ * End a micro-program at a failed step
+ * run.opcode keeps the step that failed.
+ * @param run Program in progress
+ * @return FAILED
+ */
+DS2482ProgramStatus DS2482::failProgram(DS2482Program& run) {
+    if (run.opcode == DS2482_SEQ_RESET) {
+        recordLatency(DS2482Op::WIRE_RESET, run.opStart);
+    } else if (run.opcode == DS2482_SEQ_READ) {
+        recordLatency(DS2482Op::WIRE_READ_BYTE, run.opStart);
+    }
+    currentState = DS2482State::ERROR;
+    run.code = nullptr;
+    run.issued = false;
+    run.waiting = false;
+    return DS2482ProgramStatus::FAILED;
 }
 
 /**
@@ -407,14 +1090,445 @@ void DS2482::printScratchpad(uint8_t* scratchpad) {
     DEBUG_PRINTLN("");
 }
 
+/**
+ * Clear accumulated I2C traffic counters
+ */
+void DS2482::resetBusStats() {
+    busStats = DS2482BusStats();
+}
+
+/**
+ * Model the time the given traffic occupies the I2C bus
+ * Counts 9 clocks per byte (including the address byte) plus START/STOP
+ * framing; clock stretching and inter-transaction gaps are not included.
+ * @param stats Traffic counters to evaluate
+ * @param clockHz I2C clock frequency (e.g. 100000 or 400000)
+ * @return Modelled bus time in microseconds
+ */
+uint32_t DS2482::busTimeMicros(const DS2482BusStats& stats, uint32_t clockHz) {
+    uint64_t bits = (uint64_t)stats.wireBytes() * DS2482_I2C_BITS_PER_BYTE +
+                    (uint64_t)stats.transactions * DS2482_I2C_BITS_PER_FRAME;
+    return (uint32_t)((bits * 1000000UL + clockHz - 1) / clockHz);
+}
+
+/**
+ * Enable latency histograms
+ * @param histograms Array of DS2482_OP_COUNT entries owned by the caller,
+ *                   indexed by DS2482Op, or nullptr to disable
+ */
+void DS2482::attachHistograms(DS2482Histogram* histograms) {
+    this->histograms = histograms;
+    resetHistograms();
+}
+
+/**
+ * Latency histogram of one operation
+ * @param op Operation
+ * @return Histogram, or nullptr if disabled
+ */
+const DS2482Histogram* DS2482::getHistogram(DS2482Op op) {
+    if (!histograms) {
+        return nullptr;
+    }
+    return &histograms[(uint8_t)op];
+}
+
+/**
+ * Clear all latency histograms
+ */
+void DS2482::resetHistograms() {
+    if (!histograms) {
+        return;
+    }
+    for (uint8_t i = 0; i < DS2482_OP_COUNT; i++) {
+        histograms[i].clear();
+    }
+}
+
+/**
+ * Enable energy accounting
+ * @param energy Array of 8 entries, one per channel, owned by the caller,
+ *               or nullptr to disable accounting
+ */
+void DS2482::attachEnergy(DS2482Energy* energy) {
+    this->energy = energy;
+    resetEnergy();
+}
+
+/**
+ * Accumulated active time of a channel
+ * @param channel Channel number (0-7)
+ * @return Energy record, or nullptr if disabled or the channel is invalid
+ */
+const DS2482Energy* DS2482::getEnergy(uint8_t channel) {
+    if (!energy || channel > 7) {
+        return nullptr;
+    }
+    return &energy[channel];
+}
+
+/**
+ * Clear the energy records of all channels
+ */
+void DS2482::resetEnergy() {
+    if (!energy) {
+        return;
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        energy[i].clear();
+    }
+}
+
+/**
+ * Charge of one sequential sweep: the per-sample charge of every channel
+ * that delivered samples, added up
+ * @return Charge in nAh, 0 if accounting is disabled
+ */
+uint32_t DS2482::perSweepNanoAh() {
+    if (!energy) {
+        return 0;
+    }
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        total += energy[i].perSampleNanoAh(currents);
+    }
+    return total;
+}
+
+/**
+ * Clear all accumulated times and the sample count
+ */
+void DS2482Energy::clear() {
+    i2cMicros = 0;
+    wireMicros = 0;
+    conversionMicros = 0;
+    pullupMicros = 0;
+    samples = 0;
+}
+
+/**
+ * Charge drawn for the accumulated active times
+ * @param currents Current of each kind of activity
+ * @return Charge in nAh
+ */
+uint32_t DS2482Energy::chargeNanoAh(const DS2482Currents& currents) const {
+    uint64_t charge = (uint64_t)i2cMicros * currents.i2cMicroamps +
+                      (uint64_t)wireMicros * currents.wireMicroamps +
+                      (uint64_t)conversionMicros * currents.conversionMicroamps +
+                      (uint64_t)pullupMicros * currents.pullupMicroamps;
+    return (uint32_t)(charge / DS2482_UA_US_PER_NAH);
+}
+
+/**
+ * Average charge per valid reading, including failed attempts in between
+ * @param currents Current of each kind of activity
+ * @return Charge in nAh, 0 without samples
+ */
+uint32_t DS2482Energy::perSampleNanoAh(const DS2482Currents& currents) const {
+    return samples ? chargeNanoAh(currents) / samples : 0;
+}
+
+/**
+ * Record the duration of an operation if histograms are enabled
+ * @param op Operation
+ * @param start micros() when the operation began
+ */
+void DS2482::recordLatency(DS2482Op op, uint32_t start) {
+    if (histograms) {
+        histograms[(uint8_t)op].add(clock->micros() - start);
+    }
+}
+
+/**
+ * Count one duration in its log2 bucket
+ * @param elapsed Duration in microseconds
+ */
+void DS2482Histogram::add(uint32_t elapsed) {
+    uint8_t bucket = elapsed ? (uint8_t)(8 * sizeof(unsigned long) - __builtin_clzl(elapsed)) : 0;
+    if (bucket >= DS2482_HISTOGRAM_BUCKETS) {
+        bucket = DS2482_HISTOGRAM_BUCKETS - 1;
+    }
+    if (buckets[bucket] < 0xFFFF) {
+        buckets[bucket]++;
+    }
+    if (elapsed > maxMicros) {
+        maxMicros = elapsed;
+    }
+}
+
+/**
+ * Forget all recorded durations
+ */
+void DS2482Histogram::clear() {
+    for (uint8_t i = 0; i < DS2482_HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+    maxMicros = 0;
+}
+
+/**
+ * Number of recorded durations
+ * @return Sum of all buckets
+ */
+uint32_t DS2482Histogram::count() const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < DS2482_HISTOGRAM_BUCKETS; i++) {
+        total += buckets[i];
+    }
+    return total;
+}
+
+/**
+ * Estimate a percentile of the recorded durations
+ * @param percent Percentile (0-100), e.g. 99 for the 99th percentile
+ * @return Upper bound of the bucket containing it in us (maxMicros for the
+ *         last bucket), 0 if nothing was recorded
+ */
+uint32_t DS2482Histogram::percentileMicros(uint8_t percent) const {
+    uint32_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint32_t rank = (total * (percent > 100 ? 100 : percent) + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < DS2482_HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint32_t limit = bucketLimit(i);
+            return limit < maxMicros ? limit : maxMicros;
+        }
+    }
+    return maxMicros;
+}
+
+/**
+ * Largest duration counted in a bucket
+ * @param bucket Bucket index
+ * @return Upper bound in us; the last bucket is open-ended
+ */
+uint32_t DS2482Histogram::bucketLimit(uint8_t bucket) {
+    if (bucket >= DS2482_HISTOGRAM_BUCKETS - 1) {
+        return 0xFFFFFFFFUL;
+    }
+    return (1UL << bucket) - 1;
+}
+
+/**
+ * Check the deadline of the public call in progress
+ * The first check past the deadline marks the call aborted; from then on no
+ * I2C transaction is started and every wait ends at once, so the call
+ * unwinds through its normal error paths.
+ * @return true if the call has run out of time
+ */
+bool DS2482::callExpired() {
+    if (callAborted) {
+        return callDepth > 0;
+    }
+    if (callTimeout == 0 || callDepth == 0 || clock->millis() - callStart < callTimeout) {
+        return false;
+    }
+    DEBUG_PRINTLN("Call deadline expired");
+    callAborted = true;
+    if (abortCount < 0xFFFF) {
+        abortCount++;
+    }
+    return true;
+}
+
+/**
+ * Time a single device wait may take
+ * @return DS2482_TIMEOUT_MS, or less if the call deadline is closer
+ */
+unsigned long DS2482::waitLimit() {
+    if (callExpired()) {
+        return 0;
+    }
+    if (callTimeout == 0 || callDepth == 0) {
+        return DS2482_TIMEOUT_MS;
+    }
+    unsigned long left = callTimeout - (clock->millis() - callStart);
+    return left < DS2482_TIMEOUT_MS ? left : DS2482_TIMEOUT_MS;
+}
+
+/**
+ * Write a transaction to the DS2482 and account for it
+ * @param data Bytes to write
+ * @param length Number of bytes
+ * @return true if the device acknowledged the transaction
+ */
+bool DS2482::i2cWrite(const uint8_t* data, uint8_t length) {
+    if (callExpired()) {
+        return false;
+    }
+    busStats.transactions++;
+    busStats.bytesWritten += length;
+    uint32_t start = energy ? clock->micros() : 0;
+    uint8_t result = bus->write(address, data, length);
+    if (energy) {
+        energy[targetChannel].i2cMicros += clock->micros() - start;
+    }
+    if (result != 0) {
+        busStats.failures++;
+        readPointer = DS2482_REG_UNKNOWN;   // The bridge may have taken the command byte
+        return false;
+    }
+    trackCommand(data, length);
+    return true;
+}
+
+/**
+ * Follow the read pointer and 1-Wire activity through an acknowledged command
+ * @param data Command bytes
+ * @param length Number of bytes
+ */
+void DS2482::trackCommand(const uint8_t* data, uint8_t length) {
+    if (length == 0) {
+        return;
+    }
+    switch (data[0]) {
+        case DS2482_CMD_SET_READ:
+            readPointer = length > 1 ? data[1] : DS2482_REG_UNKNOWN;
+            break;
+        case DS2482_CMD_WRITE_CONFIG:
+            readPointer = DS2482_REG_CONFIG;
+            break;
+        case DS2482_CMD_CHANNEL_SELECT:
+            readPointer = DS2482_CHANNEL_READBACK;
+            break;
+        case DS2482_CMD_RESET:
+            readPointer = DS2482_REG_STATUS;
+            finishWire(clock->micros() - wireIssueTime);  // A device reset ends any 1-Wire activity
+            break;
+        default: {
+            readPointer = DS2482_REG_STATUS;  // Every 1-Wire command
+            trackConversion(data, length);
+            bool overdrive = config & DS2482_CONFIG_1WS;
+            uint16_t slot = overdrive ? DS2482_1W_OD_SLOT_US : DS2482_1W_SLOT_US;
+            if (data[0] == DS2482_CMD_WIRE_RESET) {
+                markWirePending(overdrive ? DS2482_1W_OD_RESET_US : DS2482_1W_RESET_US);
+            } else {
+                markWirePending(data[0] == DS2482_CMD_SINGLE_BIT ? slot : 8 * slot);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Recognise 1-Wire reset, Skip ROM, Convert T: start the channel's
+ * conversion deadline and charge the conversion
+ * The sensor converts for the configured conversion time whether or not
+ * anyone polls for it, so the whole time is charged when Convert T goes out,
+ * however the sequence was issued (driver, DS2482Snapshot or application).
+ * With the strong pullup enabled, the conversion runs on it.
+ * @param data Acknowledged 1-Wire command bytes
+ * @param length Number of bytes
+ */
+void DS2482::trackConversion(const uint8_t* data, uint8_t length) {
+    uint8_t byte = length > 1 ? data[1] : 0;
+    if (data[0] == DS2482_CMD_WIRE_RESET) {
+        romPhase = 1;
+    } else if (data[0] == DS2482_CMD_WRITE_BYTE && romPhase == 1 && byte == 0xCC) {
+        romPhase = 2;   // Skip ROM
+    } else {
+        if (data[0] == DS2482_CMD_WRITE_BYTE && romPhase == 2 && byte == 0x44) {
+            conversionStarts[targetChannel] = clock->millis();
+            convertingMask |= 1 << targetChannel;
+            if (energy) {
+                uint32_t time = (uint32_t)conversionTime * 1000;
+                if (config & DS2482_CONFIG_SPU) {
+                    energy[targetChannel].pullupMicros += time;
+                } else {
+                    energy[targetChannel].conversionMicros += time;
+                }
+            }
+        }
+        romPhase = 0;
+    }
+}
+
+/**
+ * Read a single byte from the current read pointer and account for it
+ * @param value Destination for the byte read
+ * @return true if a byte was received
+ */
+bool DS2482::i2cRead(uint8_t* value) {
+    if (callExpired()) {
+        return false;
+    }
+    busStats.transactions++;
+    uint32_t start = energy ? clock->micros() : 0;
+    uint8_t received = bus->read(address, value, 1);
+    if (energy) {
+        energy[targetChannel].i2cMicros += clock->micros() - start;
+    }
+    if (received != 1) {
+        busStats.failures++;
+        return false;
+    }
+    busStats.bytesRead++;
+    return true;
+}
+
+/**
+ * Classify a DS18B20 scratchpad
+ * @param scratchpad 9 bytes as read from the sensor
+ * @return VALID, or the first check that failed
+ */
+DS2482Frame DS2482::checkScratchpad(const uint8_t* scratchpad) {
+    bool allOnes = true;
+    bool allZeros = true;
+    for (uint8_t i = 0; i < 9; i++) {
+        allOnes = allOnes && scratchpad[i] == 0xFF;
+        allZeros = allZeros && scratchpad[i] == 0x00;
+    }
+    if (allOnes) {
+        return DS2482Frame::ALL_ONES;
+    }
+    if (allZeros) {
+        return DS2482Frame::ALL_ZEROS;  // Passes the CRC, must be caught explicitly
+    }
+    if (crc8(scratchpad, 8) != scratchpad[8]) {
+        return DS2482Frame::CRC_ERROR;
+    }
+    if (((scratchpad[1] << 8) | scratchpad[0]) == DS2482_RAW_POWER_ON) {
+        return DS2482Frame::POWER_ON_RESET;
+    }
+    return DS2482Frame::VALID;
+}
+
+/**
+ * Dallas/Maxim 1-Wire CRC8 (polynomial x^8 + x^5 + x^4 + 1)
+ * @param data Bytes to check
+ * @param length Number of bytes
+ * @return CRC of the data
+ */
+uint8_t DS2482::crc8(const uint8_t* data, uint8_t length) {
+    uint8_t crc = 0;
+    while (length--) {
+        uint8_t inbyte = *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
 /**
  * Write command to DS2482
  * @param command Command byte to write
  */
-void DS2482::writeCommand(uint8_t command) {
-    Wire.beginTransmission(address);
-    Wire.write(command);
-    Wire.endTransmission();
+bool DS2482::writeCommand(uint8_t command) {
+    return i2cWrite(&command, 1);
 }
 
 /**
@@ -422,33 +1536,207 @@ void DS2482::writeCommand(uint8_t command) {
  * @param readPointer Read pointer value
  */
 void DS2482::setReadPointer(uint8_t readPointer) {
-    Wire.beginTransmission(address);
-    Wire.write(DS2482_CMD_SET_READ);
-    Wire.write(readPointer);
-    Wire.endTransmission();
+    if (readPointer == this->readPointer) {
+        return;     // Already there
+    }
+    uint8_t command[2] = {DS2482_CMD_SET_READ, readPointer};
+    i2cWrite(command, 2);
 }
 
 /**
  * Wait for 1-Wire bus to be ready
+ * @param status Optional, receives the last status register value read
  * @return true if bus becomes ready before timeout
  */
-bool DS2482::waitFor1Wire() {
-    unsigned long startTime = millis();
-    while ((readStatus() & DS2482_STATUS_1WB) && (millis() - startTime < 100)) {
-        delayMicroseconds(100);  // Short delay between checks
+bool DS2482::waitFor1Wire(uint8_t* status) {
+    CallScope scope(*this);
+    uint32_t start = clock->micros();
+    unsigned long startTime = clock->millis();
+    uint8_t value;
+    unsigned long limit = waitLimit();
+    while (((value = readStatus()) & DS2482_STATUS_1WB) && (clock->millis() - startTime < limit)) {
+        clock->delayMicroseconds(DS2482_POLL_INTERVAL_US);  // Short delay between checks
     }
-    return (millis() - startTime < 100);
+    if (status) {
+        *status = value;
+    }
+    if (value & DS2482_STATUS_1WB) {
+        recordLatency(DS2482Op::TIMEOUT, start);
+        return false;
+    }
+    return true;
 }
 
 /**
- * Initialize temperature operation with wire reset
- * @return true if wire reset successful
+ * Remember that a 1-Wire command was issued; a status read with 1WB clear
+ * forgets it again
+ * @param nominal Duration of the command on the line in microseconds
  */
-bool DS2482::beginTemperatureOperation() {
-    currentState = DS2482State::IDLE;
-    if (!wireReset()) {
-        DEBUG_PRINTLN("1-Wire reset failed, no device detected");
+void DS2482::markWirePending(uint16_t nominal) {
+    wirePending = true;
+    wireIssueTime = clock->micros();
+    wireNominal = nominal;
+}
+
+/**
+ * Forget the pending 1-Wire command and charge its busy time
+ * The time until the driver noticed is an upper bound; the command itself
+ * never takes longer than its nominal duration.
+ * @param busy Microseconds since the command was issued
+ */
+void DS2482::finishWire(uint32_t busy) {
+    if (wirePending && energy) {
+        energy[targetChannel].wireMicros += busy < wireNominal ? busy : wireNominal;
+    }
+    wirePending = false;
+}
+
+/**
+ * Wait for the last 1-Wire command, if it may still run
+ * Its nominal duration is only typical: the bridge times the line from its
+ * own oscillator, so even long after it 1WB is read once before the next
+ * command rather than assumed clear.
+ * @return false if the bus is still busy at the timeout
+ */
+bool DS2482::waitIfWirePending() {
+    if (!wirePending) {
+        return true;
+    }
+    return waitFor1Wire();
+}
+
+/**
+ * Write the configuration register
+ * The value is cached even if the write fails, so recover() applies it once
+ * the bridge responds again. APU and SPU stay off in the passive pullup
+ * design this library assumes; a device reset clears all bits. Writing the
+ * configuration also clears RST, which is how the driver later notices an
+ * unexpected device reset.
+ * @param config DS2482_CONFIG_* bits
+ * @return true if the bridge confirmed the new configuration
+ */
+bool DS2482::writeConfig(uint8_t config) {
+    CallScope scope(*this);
+    this->config = config & 0x0F;
+    if (!waitIfWirePending()) {  // The bridge NACKs a config write while 1WB is set
+        DEBUG_PRINTLN("1-Wire bus busy during configuration write");
+        configApplied = false;
+        currentState = DS2482State::ERROR;
+        return false;
+    }
+
+    // Upper nibble carries the one's complement of the lower one
+    uint8_t command[2] = {DS2482_CMD_WRITE_CONFIG, (uint8_t)(this->config | (~this->config << 4))};
+    uint8_t readBack;
+    if (!i2cWrite(command, 2) || !i2cRead(&readBack) || readBack != this->config) {
+        DEBUG_PRINTLN("Configuration write failed");
+        configApplied = false;
+        currentState = DS2482State::ERROR;
         return false;
     }
+    configApplied = true;   // RST is clear now
     return true;
+}
+
+/**
+ * Bring the bridge back into a working state after an error
+ * Tiers are tried cheapest first and stop at the first that works:
+ * 1. 1-Wire reset on the selected channel, after reading back that the
+ *    bridge still has it selected (about 1 ms)
+ * 2. Select the last requested channel again
+ * 3. Device reset, then cached configuration and channel; used directly
+ *    when RST shows that the bridge was reset since begin()
+ * 4. Re-initialise the transport, then as tier 3; if a slave held SDA
+ *    low, the transport clocks it free first (DS2482Recovery::BUS_CLEAR)
+ * A channel passes when its 1-Wire reset completes without a short; a
+ * missing presence pulse is a sensor problem no tier can fix. A conversion
+ * in progress is abandoned.
+ * @return Tier that restored the bridge, or DS2482Recovery::FAILED
+ */
+DS2482Recovery DS2482::recover() {
+    CallScope scope(*this);
+    DEBUG_PRINTLN("Recovering DS2482");
+    DS2482Recovery tier = DS2482Recovery::FAILED;
+
+    // Writing the configuration clears RST, so RST set afterwards means the
+    // bridge was reset and lost it; only tier 3 restores it
+    bool configLost = !configApplied || (readStatus() & DS2482_STATUS_RST);
+
+    if (!configLost && verifyChannel() && checkWire()) {
+        tier = DS2482Recovery::WIRE_RESET;
+    } else if (!configLost && selectChannel(targetChannel) && checkWire()) {
+        tier = DS2482Recovery::RESELECT;
+    } else if (restoreDevice()) {
+        tier = DS2482Recovery::DEVICE_RESET;
+    } else {
+        // A transport that cleared the bus has re-initialised itself
+        bool cleared = bus->clearBus();
+        if (!cleared) {
+            bus->begin();
+        }
+        if (restoreDevice()) {
+            tier = cleared ? DS2482Recovery::BUS_CLEAR : DS2482Recovery::BUS_REINIT;
+        }
+    }
+
+    currentState = tier == DS2482Recovery::FAILED ? DS2482State::ERROR : DS2482State::IDLE;
+    if (recoveryCounts[(uint8_t)tier] < 0xFFFF) {
+        recoveryCounts[(uint8_t)tier]++;
+    }
+    DEBUG_PRINT("Recovery tier: ");
+    DEBUG_PRINTLN((uint8_t)tier);
+    return tier;
+}
+
+/**
+ * Clear the per-tier recovery counters
+ */
+void DS2482::resetRecoveryCounts() {
+    for (uint8_t i = 0; i < DS2482_RECOVERY_COUNT; i++) {
+        recoveryCounts[i] = 0;
+    }
+}
+
+/**
+ * Read back the channel register without selecting
+ * @return true if the bridge has the tracked channel selected
+ */
+bool DS2482::verifyChannel() {
+    if (currentChannel > 7) {
+        return false;
+    }
+    waitIfWirePending();
+    setReadPointer(DS2482_CHANNEL_READBACK);
+    uint8_t readBack;
+    if (i2cRead(&readBack) && readBack == readBackValues[currentChannel]) {
+        return true;
+    }
+    currentChannel = DS2482_CHANNEL_UNKNOWN;
+    return false;
+}
+
+/**
+ * Check the selected channel with a 1-Wire reset
+ * @return true if the reset completed and no short was detected
+ */
+bool DS2482::checkWire() {
+    uint8_t status;
+    if (!startWireReset() || !waitFor1Wire(&status)) {
+        return false;
+    }
+    return !(status & DS2482_STATUS_SD);
+}
+
+/**
+ * Reset the device and restore the cached configuration and channel
+ * @return true if the restored channel passes checkWire()
+ */
+bool DS2482::restoreDevice() {
+    if (!reset()) {
+        return false;
+    }
+    if (!writeConfig(config)) {
+        return false;
+    }
+    return selectChannel(targetChannel) && checkWire();
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
  * - Multi-channel support (8 channels)
  * - Comprehensive error checking
  * - Optional diagnostic output
+ * - Pluggable I2C transport with per-transaction bus accounting
+ * - Pluggable clock, for simulation in virtual time
  * 
  * To enable diagnostic output, define DS2482_DIAGNOSTICS before including this header:
  * #define DS2482_DIAGNOSTICS 1
@@ -49,6 +51,14 @@
 #define DS2482_CMD_READ_BYTE      0x96    // Read byte
 #define DS2482_CMD_SINGLE_BIT     0x87    // Single bit operation
 
+#define DS2482_CHANNEL_UNKNOWN    0xFF    // getCurrentChannel() when the selection is not verified
+
+// Read pointer codes (channel register: DS2482_CHANNEL_READBACK)
+#define DS2482_REG_STATUS         0xF0    // Status register
+#define DS2482_REG_DATA           0xE1    // Read data register
+#define DS2482_REG_CONFIG         0xC3    // Configuration register
+#define DS2482_REG_UNKNOWN        0x00    // Read pointer not known to the driver
+
 // Status register bit masks
 #define DS2482_STATUS_1WB     0x01    // 1-Wire Busy
 #define DS2482_STATUS_PPD     0x02    // Presence Pulse Detect
@@ -59,6 +69,62 @@
 #define DS2482_STATUS_TSB     0x40    // Triple Search Bit
 #define DS2482_STATUS_DIR     0x80    // Branch Direction Taken
 
+// Configuration register bits
+#define DS2482_CONFIG_APU     0x01    // Active Pullup
+#define DS2482_CONFIG_SPU     0x04    // Strong Pullup
+#define DS2482_CONFIG_1WS     0x08    // 1-Wire Speed (overdrive)
+
+// Driver timing - shared by the driver, DS2482CostModel and DS2482Sim
+#define DS2482_TIMEOUT_MS          100     // Limit for any single device wait
+#define DS2482_POLL_INTERVAL_US    100     // Delay between status polls
+#define DS2482_CHANNEL_SETTLE_US   100     // Delay after channel select
+#define DS2482_CONVERSION_TIME_MS  750     // DS18B20 12-bit conversion time
+
+// 1-Wire timing of the DS2482 (datasheet typical values)
+#define DS2482_1W_RESET_US         1148    // Standard speed tRSTL + tRSTH
+#define DS2482_1W_SLOT_US          73      // Standard speed time slot incl. recovery
+#define DS2482_1W_OD_RESET_US      146     // Overdrive tRSTL + tRSTH
+#define DS2482_1W_OD_SLOT_US       10      // Overdrive time slot incl. recovery
+
+// Raw DS18B20 values (1/16 °C) that never represent a valid measurement
+#define DS2482_RAW_POWER_ON        0x0550  // 85.00 °C power-on reset scratchpad
+#define DS2482_RAW_DISCONNECTED    (-2032) // -127.00 °C, conventional "no sensor" marker
+
+// 1-Wire micro-program opcodes, see runProgram(); WRITE and READ carry a
+// byte count of 1-15 in the low nibble
+#define DS2482_SEQ_END             0x00    // Program done
+#define DS2482_SEQ_SELECT          0x10    // selectChannel() on the program's channel
+#define DS2482_SEQ_RESET           0x20    // 1-Wire reset, fails without a presence pulse
+#define DS2482_SEQ_WRITE           0x30    // | n: write the n bytes that follow
+#define DS2482_SEQ_READ            0x40    // | n: read n bytes into the program's buffer
+#define DS2482_SEQ_OPCODE_MASK     0xF0
+#define DS2482_SEQ_COUNT_MASK      0x0F
+
+// Typical I2C framing overhead used by the bus time model
+#define DS2482_I2C_BITS_PER_BYTE   9       // 8 data bits + ACK/NACK
+#define DS2482_I2C_BITS_PER_FRAME  2       // START and STOP conditions
+
+// I2C bus clearing (DS2482WireBus::clearBus())
+#define DS2482_NO_PIN              0xFF    // No GPIO assigned
+#define DS2482_BUS_CLEAR_CLOCKS    9       // SCL pulses to finish any byte a slave is sending
+#define DS2482_BUS_CLEAR_HALF_US   5       // Half SCL period, 100 kHz
+
+// Latency histograms: bucket n counts durations of 2^(n-1) .. 2^n - 1 us,
+// bucket 0 counts 0 us and the last bucket everything from 2^18 us up
+#define DS2482_HISTOGRAM_BUCKETS   20
+#define DS2482_OP_COUNT            6
+
+#define DS2482_RECOVERY_COUNT      6       // Entries of DS2482Recovery
+
+#define DS2482_NEVER_MS            0x7FFFFFFFUL  // Longest wrap-safe millis() delay, "no event"
+
+// Default currents for energy accounting, typical datasheet figures in uA
+#define DS2482_CURRENT_I2C_UA         600     // Bridge active plus SDA/SCL pullups
+#define DS2482_CURRENT_1W_UA          1000    // Bridge active plus 1-Wire pullup while the line is low
+#define DS2482_CURRENT_CONVERSION_UA  1000    // Externally powered DS18B20 converting
+#define DS2482_CURRENT_PULLUP_UA      1500    // Parasite-powered DS18B20 converting on the strong pullup
+#define DS2482_UA_US_PER_NAH          3600000UL  // uA x us in one nAh
+
 // Operation states for state machine
 enum class DS2482State {
     IDLE,                   // No operation in progress
@@ -66,13 +132,189 @@ enum class DS2482State {
     ERROR                   // Error state requiring reset
 };
 
+// Classification of the last scratchpad read by readTemperatureRaw()
+enum class DS2482Frame : uint8_t {
+    NONE,           // No scratchpad was read (bus or presence failure)
+    VALID,          // CRC correct, plausible value
+    POWER_ON_RESET, // 85.00 °C power-on value, sensor browned out or never converted
+    ALL_ONES,       // Every byte 0xFF, nothing drove the bus
+    ALL_ZEROS,      // Every byte 0x00, line held low
+    CRC_ERROR,      // Scratchpad CRC mismatch
+    BUS_ERROR       // A transaction of the scratchpad read failed; nothing to classify
+};
+
+// Driver operations with a latency histogram
+enum class DS2482Op : uint8_t {
+    SELECT_CHANNEL,     // selectChannel()
+    WIRE_RESET,         // wireReset()
+    WIRE_READ_BYTE,     // wireReadByte()
+    WIRE_WRITE_BYTE,    // wireWriteByte()
+    ACQUISITION,        // readTemperatureRaw(): select, reset and scratchpad read
+    TIMEOUT             // Time spent in any wait that timed out
+};
+
+// Tier that restored the bridge in recover(), cheapest first
+enum class DS2482Recovery : uint8_t {
+    WIRE_RESET,         // A 1-Wire reset on the selected channel was enough
+    RESELECT,           // The channel had to be selected again
+    DEVICE_RESET,       // Device reset, configuration and channel restored
+    BUS_REINIT,         // Transport re-initialised before the device reset
+    BUS_CLEAR,          // SDA was stuck low and had to be clocked free first
+    FAILED              // No tier restored the bridge
+};
+
+// Path taken by warmStart()
+enum class DS2482Start : uint8_t {
+    WARM,               // Bridge kept power and state; one status read
+    POWER_UP,           // Bridge was powered up since; configuration written again
+    FULL,               // Shadow not usable or bridge not idle; begin() was run
+    FAILED              // begin() failed as well
+};
+
+// Result of stepProgram()
+enum class DS2482ProgramStatus : uint8_t {
+    RUNNING,            // More steps to go
+    DONE,               // DS2482_SEQ_END reached
+    FAILED              // A step failed, the deadline passed or no program was started
+};
+
+// Progress of one micro-program, owned by the caller of startProgram()
+struct DS2482Program {
+    const uint8_t* code;        // Bytecode, nullptr once the program has ended
+    uint8_t* data;              // Where DS2482_SEQ_READ stores the next byte
+    uint8_t channel;            // Channel of DS2482_SEQ_SELECT
+    uint8_t counter;            // Index of the next bytecode byte
+    uint8_t opcode;             // DS2482_SEQ_* of the current step, the failed one after FAILED
+    uint8_t remaining;          // Operations left of it
+    bool issued;                // Its reset or read byte went out, the result is not in yet
+    bool waiting;               // Polling a busy bridge since waitStart
+    bool retried;               // The 1-Wire reset was repeated after a bridge reset
+    uint16_t resets;            // Device reset count when the 1-Wire reset went out
+    uint32_t opStart;           // micros() when the current operation began
+    uint32_t waitStart;         // micros() of the first busy poll
+};
+
+// Micro-programs of the DS18B20 operations, defined in DS2482.cpp
+extern const uint8_t DS2482_PROGRAM_CONVERT[];          // Select, reset, Skip ROM, Convert T
+extern const uint8_t DS2482_PROGRAM_READ_TEMPERATURE[]; // Select, reset, Skip ROM, Read Scratchpad, 9 bytes
+extern const uint8_t DS2482_PROGRAM_READ_SCRATCHPAD[];  // The same on the selected channel
+
+// Bridge state to keep across MCU sleep (retained or RTC memory)
+struct DS2482Shadow {
+    uint8_t config;         // Configuration register
+    uint8_t channel;        // Selected channel, DS2482_CHANNEL_UNKNOWN if not verified
+    uint8_t readPointer;    // DS2482_REG_*, DS2482_REG_UNKNOWN if not known
+    bool valid;             // Taken after a successful begin(); false in zeroed memory
+};
+
+// Fixed-size log2 latency histogram
+struct DS2482Histogram {
+    uint16_t buckets[DS2482_HISTOGRAM_BUCKETS];  // Saturating counters
+    uint32_t maxMicros;                          // Longest duration seen
+
+    void add(uint32_t elapsed);
+    void clear();
+    uint32_t count() const;
+    uint32_t percentileMicros(uint8_t percent) const;   // Upper bound of the bucket holding the percentile
+    static uint32_t bucketLimit(uint8_t bucket);         // Largest duration counted in a bucket
+};
+
+// Currents charged for each kind of activity, in uA
+struct DS2482Currents {
+    uint16_t i2cMicroamps;          // While an I2C transaction is in progress
+    uint16_t wireMicroamps;         // While the bridge is busy on the 1-Wire line
+    uint16_t conversionMicroamps;   // While a sensor converts
+    uint16_t pullupMicroamps;       // While a conversion runs on the strong pullup
+};
+
+// Active time of one channel, accumulated while energy accounting is enabled
+struct DS2482Energy {
+    uint32_t i2cMicros;             // I2C transactions on behalf of the channel
+    uint32_t wireMicros;            // 1-Wire busy time
+    uint32_t conversionMicros;      // Conversions on external power
+    uint32_t pullupMicros;          // Conversions on the strong pullup (DS2482_CONFIG_SPU)
+    uint32_t samples;               // Valid readings taken
+
+    void clear();
+    uint32_t chargeNanoAh(const DS2482Currents& currents) const;     // All accumulated charge
+    uint32_t perSampleNanoAh(const DS2482Currents& currents) const;  // Charge / samples, 0 without samples
+};
+
+// I2C traffic counters, accumulated for every transaction the driver issues
+struct DS2482BusStats {
+    uint32_t transactions;  // Number of START ... STOP frames
+    uint32_t bytesWritten;  // Payload bytes written (excluding address byte)
+    uint32_t bytesRead;     // Payload bytes read (excluding address byte)
+    uint32_t failures;      // NACKed writes and short reads
+
+    uint32_t wireBytes() const { return transactions + bytesWritten + bytesRead; }
+};
+
+/**
+ * I2C transport used by the driver
+ * The default implementation wraps the Arduino Wire library. Alternative
+ * transports (e.g. the DS2482Sim simulated bridge) can be passed to the
+ * DS2482 constructor.
+ */
+class DS2482Bus {
+public:
+    virtual ~DS2482Bus() {}
+    virtual void begin() = 0;                                                        // Initialize the bus
+    virtual uint8_t write(uint8_t address, const uint8_t* data, uint8_t length) = 0; // 0 on ACK, Wire error code otherwise
+    virtual uint8_t read(uint8_t address, uint8_t* data, uint8_t length) = 0;        // Number of bytes received
+    virtual bool clearBus() { return false; }                                        // Free a stuck SDA; true if it was stuck (bus initialised again)
+};
+
+// Transport backed by a TwoWire instance (Wire by default)
+class DS2482WireBus : public DS2482Bus {
+public:
+    DS2482WireBus(TwoWire& wire = Wire) : wire(wire), sdaPin(DS2482_NO_PIN), sclPin(DS2482_NO_PIN) {}
+    void begin() override;
+    uint8_t write(uint8_t address, const uint8_t* data, uint8_t length) override;
+    uint8_t read(uint8_t address, uint8_t* data, uint8_t length) override;
+    void setBusPins(uint8_t sda, uint8_t scl) { sdaPin = sda; sclPin = scl; }  // GPIOs of SDA/SCL, enables clearBus()
+    bool clearBus() override;
+
+private:
+    TwoWire& wire;
+    uint8_t sdaPin;             // DS2482_NO_PIN when bus clearing is disabled
+    uint8_t sclPin;
+};
+
+/**
+ * Time source used by the driver, the sampling engines and the simulator
+ * The default implementation uses the Arduino timing functions. Other clocks
+ * (DS2482VirtualClock, DS2482SteadyClock in DS2482Clock.h) can be passed to
+ * the DS2482 constructor.
+ */
+class DS2482Clock {
+public:
+    virtual ~DS2482Clock() {}
+    virtual uint32_t millis() = 0;                      // Milliseconds, wraps like Arduino millis()
+    virtual uint32_t micros() = 0;                      // Microseconds, wraps like Arduino micros()
+    virtual void delayMicroseconds(uint32_t us) = 0;    // Busy wait
+};
+
+// Clock backed by the Arduino millis(), micros() and delayMicroseconds()
+class DS2482ArduinoClock : public DS2482Clock {
+public:
+    uint32_t millis() override { return ::millis(); }
+    uint32_t micros() override { return ::micros(); }
+    void delayMicroseconds(uint32_t us) override;
+};
+
 class DS2482 {
 public:
     // Constructor and initialization
-    DS2482(uint8_t address = 0x18);
+    DS2482(uint8_t address = 0x18, DS2482Bus* bus = nullptr, DS2482Clock* clock = nullptr);
     bool begin();          // Initialize device
     bool reset();          // Reset device
     bool wakeUp();         // Wake up device
+
+    // Warm start after MCU sleep: resume from the shadow instead of begin()
+    DS2482Start warmStart();                             // With the state this object still holds
+    DS2482Start warmStart(const DS2482Shadow& shadow);   // With a state saved by getShadow()
+    DS2482Shadow getShadow();                            // State to keep across sleep
     
     // Basic device operations
     uint8_t readStatus();  // Read status register
@@ -80,38 +322,146 @@ public:
     
     // Channel operations
     bool selectChannel(uint8_t channel);  // Select 1-Wire channel (0-7)
-    uint8_t getCurrentChannel() { return currentChannel; }
+    uint8_t getCurrentChannel() { return currentChannel; }  // DS2482_CHANNEL_UNKNOWN if not verified
     
     // 1-Wire operations
     bool wireReset();                     // Reset 1-Wire bus
     void wireWriteBit(uint8_t bit);      // Write single bit
     uint8_t wireReadBit();               // Read single bit
-    void wireWriteByte(uint8_t byte);    // Write byte
+    bool wireWriteByte(uint8_t byte);    // Write byte, false if the bridge did not take it
     uint8_t wireReadByte();              // Read byte
 
+    // Split-phase 1-Wire operations, for overlapping several bridges
+    bool startWireReset();                           // Issue a 1-Wire reset without waiting for it
+    bool waitFor1Wire(uint8_t* status = nullptr);    // Wait for 1-Wire bus ready, optionally return status
+
     // Temperature sensor operations
     bool startTemperatureConversion(uint8_t channel);  // Start conversion
     bool checkConversionStatus();                      // Check if conversion complete
+    bool checkConversionStatus(uint8_t channel);       // Conversion time of this channel has passed
+    unsigned long getConversionDue(uint8_t channel);   // millis() the channel's last conversion completes
+    uint8_t getConvertingChannels();                   // Channels whose conversion time has not passed
+    bool nextConversionDue(unsigned long* due);        // Earliest completion; false if none converting
+    void setConversionTime(uint16_t ms) { conversionTime = ms; }  // Wait used by checkConversionStatus()
+    uint16_t getConversionTime() { return conversionTime; }
+    uint32_t getConversionStartMicros() { return conversionStartMicros; }    // micros() when Convert T was issued
+    uint32_t getConversionFinishMicros() { return conversionFinishMicros; }  // micros() when completion was detected
     bool readTemperature(uint8_t channel, float* temperature);  // Read temperature
+    bool readTemperatureRaw(uint8_t channel, int16_t* raw);     // Read temperature in 1/16 °C
+    DS2482Frame getLastFrame() { return lastFrame; }           // Result of the last scratchpad check
     bool readScratchpad(uint8_t* scratchpad);         // Read sensor scratchpad
     void printScratchpad(uint8_t* scratchpad);        // Print scratchpad data
+    static DS2482Frame checkScratchpad(const uint8_t* scratchpad);  // Validate 9 scratchpad bytes
+    static uint8_t crc8(const uint8_t* data, uint8_t length);      // Dallas/Maxim 1-Wire CRC
+
+    // 1-Wire micro-programs (DS2482_SEQ_* bytecode)
+    bool runProgram(const uint8_t* program, uint8_t channel, uint8_t* data = nullptr);    // Run to the end
+    void startProgram(DS2482Program& run, const uint8_t* program, uint8_t channel, uint8_t* data = nullptr);
+    DS2482ProgramStatus stepProgram(DS2482Program& run);    // One step of a started program; only a select waits
 
     // State management
     DS2482State getState() { return currentState; }
     bool isBusy() { return currentState == DS2482State::CONVERTING_TEMPERATURE; }
     void clearState() { currentState = DS2482State::IDLE; }
 
+    // Configuration register
+    bool writeConfig(uint8_t config);     // DS2482_CONFIG_* bits, cached and restored by recover()
+    uint8_t getConfig() { return config; }
+
+    // Shadow of the bridge state, kept from every transaction
+    uint8_t getReadPointer() { return readPointer; }      // DS2482_REG_*, DS2482_REG_UNKNOWN if not known
+    uint8_t getLastStatus() { return lastStatus; }        // Status register as last read
+    bool isConfigApplied() { return configApplied; }      // Configuration written since the last device reset
+    uint16_t getDeviceResetCount() { return deviceResets; }  // Device resets the driver did not issue
+
+    // Call deadline: total time any public call may take, across all its waits
+    void setCallTimeout(uint16_t ms) { callTimeout = ms; }  // 0 = only the DS2482_TIMEOUT_MS limit per wait
+    uint16_t getCallTimeout() { return callTimeout; }
+    bool wasAborted() { return callAborted; }           // Last call ran out of time
+    uint16_t getAbortCount() { return abortCount; }     // Calls aborted at their deadline
+    void resetAbortCount() { abortCount = 0; }
+
+    // Error recovery
+    DS2482Recovery recover();             // Restore the bridge with the cheapest tier that works
+    uint16_t getRecoveryCount(DS2482Recovery tier) { return recoveryCounts[(uint8_t)tier]; }
+    void resetRecoveryCounts();
+
+    // Time source, shared with DS2482Sampler, DS2482Scheduler and DS2482Snapshot
+    DS2482Clock& getClock() { return *clock; }
+
+    // Bus accounting
+    const DS2482BusStats& getBusStats() { return busStats; }
+    void resetBusStats();
+    static uint32_t busTimeMicros(const DS2482BusStats& stats, uint32_t clockHz);  // Modelled time on the wire
+
+    // Latency histograms
+    void attachHistograms(DS2482Histogram* histograms);  // Array of DS2482_OP_COUNT, or nullptr to disable
+    const DS2482Histogram* getHistogram(DS2482Op op);
+    void resetHistograms();
+
+    // Energy accounting
+    void attachEnergy(DS2482Energy* energy);        // Array of 8, one per channel, or nullptr to disable
+    const DS2482Energy* getEnergy(uint8_t channel);
+    void resetEnergy();
+    void setCurrents(const DS2482Currents& currents) { this->currents = currents; }
+    const DS2482Currents& getCurrents() { return currents; }
+    uint32_t perSweepNanoAh();                      // Per-sample charge summed over sampled channels
+
 private:
     uint8_t address;            // I2C address of DS2482
+    DS2482Bus* bus;             // I2C transport
+    DS2482Clock* clock;         // Time source
+    DS2482BusStats busStats;    // Accumulated I2C traffic
     DS2482State currentState;   // Current operation state
-    unsigned long conversionStartTime;  // Timestamp for conversion timing
+    unsigned long conversionStarts[8];  // millis() of each channel's last Convert T
+    uint8_t convertingMask;     // Channels with a conversion not yet seen complete
+    uint8_t conversionChannel;  // Channel of startTemperatureConversion()
+    uint32_t conversionStartMicros;     // Capture time of the last Convert T
+    uint32_t conversionFinishMicros;    // Capture time of the last completed conversion
+    uint16_t conversionTime;    // Conversion wait in milliseconds
     uint8_t currentChannel;     // Currently selected channel
+    uint8_t targetChannel;      // Channel last requested, restored by recover()
+    uint8_t config;             // Configuration register as last written
+    bool configApplied;         // config is in the bridge and RST is clear
+    uint8_t readPointer;        // Register the next read returns
+    uint8_t lastStatus;         // Status register as last read
+    uint16_t deviceResets;      // RST seen while configApplied
+    uint16_t recoveryCounts[DS2482_RECOVERY_COUNT];  // recover() results per tier
+    DS2482Frame lastFrame;      // Result of the last scratchpad check
+    DS2482Histogram* histograms;  // Latency histograms, nullptr when disabled
+    DS2482Energy* energy;       // Per-channel active time, nullptr when disabled
+    DS2482Currents currents;    // Currents applied to it
+    uint8_t romPhase;           // Progress through reset, Skip ROM, Convert T
+    uint16_t callTimeout;       // Call deadline in ms, 0 = disabled
+    unsigned long callStart;    // millis() when the outermost public call began
+    uint8_t callDepth;          // Nesting of public calls in progress
+    bool callAborted;           // Deadline of the current or last call expired
+    uint16_t abortCount;        // Calls aborted at their deadline
+    bool wirePending;           // A 1-Wire command was issued without waiting for it
+    uint32_t wireIssueTime;     // micros() when it was issued
+    uint16_t wireNominal;       // Its duration in us at the configured speed
     
+    struct CallScope;           // Arms the call deadline, see DS2482.cpp
+
     // Private helper functions
-    void writeCommand(uint8_t command);           // Write command to device
-    void setReadPointer(uint8_t readPointer);     // Set read pointer
-    bool waitFor1Wire();                          // Wait for 1-Wire bus ready
-    bool beginTemperatureOperation();             // Initialize temperature operation
+    bool i2cWrite(const uint8_t* data, uint8_t length);  // Counted write transaction
+    bool i2cRead(uint8_t* value);                 // Counted single byte read transaction
+    bool writeCommand(uint8_t command);           // Write command to device
+    void setReadPointer(uint8_t readPointer);     // Set read pointer unless already there
+    void trackCommand(const uint8_t* data, uint8_t length);  // Follow read pointer and 1-Wire activity
+    bool runProgram(DS2482Program& run);          // Step a started program to its end
+    DS2482ProgramStatus waitProgram(DS2482Program& run);  // Bridge busy: RUNNING, or FAILED at the timeout
+    DS2482ProgramStatus failProgram(DS2482Program& run);  // End the program in ERROR state
+    void recordLatency(DS2482Op op, uint32_t start);  // Add micros() - start to a histogram
+    void markWirePending(uint16_t nominal);       // Note a 1-Wire command was issued
+    void finishWire(uint32_t busy);               // It is done; charge its busy time
+    void trackConversion(const uint8_t* data, uint8_t length);  // Deadline and charge of a Convert T
+    bool waitIfWirePending();                     // Wait for it before commands the bridge would NACK
+    bool callExpired();                           // Deadline of the public call passed
+    unsigned long waitLimit();                    // Time left for one device wait
+    bool verifyChannel();                         // Channel readback matches currentChannel
+    bool checkWire();                             // 1-Wire reset completes without a short
+    bool restoreDevice();                         // Device reset, then configuration and channel
 };
 
 #endif
\ No newline at end of file
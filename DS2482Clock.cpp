@@ -0,0 +1,58 @@
+/**
+ * APADevices - DS2482Clock.cpp - Virtual and host clocks for the DS2482 driver
+ *
+ * Both clocks count from zero, so millis() wraps after 49.7 days like the
+ * Arduino counter; DS2482VirtualClock::set() reaches the wrap without the
+ * wait.
+ */
+
+#include "DS2482Clock.h"
+
+#if DS2482_HAS_STEADY_CLOCK
+#include <chrono>
+#endif
+
+/**
+ * Current time in milliseconds, truncated to 32 bits
+ * @return Milliseconds since time zero
+ */
+uint32_t DS2482VirtualClock::millis() {
+    now += step;
+    return (uint32_t)(now / 1000);
+}
+
+/**
+ * Current time in microseconds, truncated to 32 bits
+ * @return Microseconds since time zero
+ */
+uint32_t DS2482VirtualClock::micros() {
+    now += step;
+    return (uint32_t)now;
+}
+
+#if DS2482_HAS_STEADY_CLOCK
+/**
+ * Constructor - time zero is now
+ */
+DS2482SteadyClock::DS2482SteadyClock() : origin(0) {
+    origin = (int64_t)elapsed();
+}
+
+/**
+ * Time since construction
+ * @return Microseconds
+ */
+uint64_t DS2482SteadyClock::elapsed() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(now).count() - origin);
+}
+
+/**
+ * Busy wait, as the Arduino core does
+ * @param us Microseconds to wait
+ */
+void DS2482SteadyClock::delayMicroseconds(uint32_t us) {
+    uint64_t start = elapsed();
+    while (elapsed() - start < us);
+}
+#endif
@@ -0,0 +1,77 @@
+/**
+ * APADevices - DS2482Clock.h - Virtual and host clocks for the DS2482 driver
+ *
+ * The driver, DS2482Sim, DS2482FaultBus and the sampling engines take all
+ * time from a DS2482Clock. DS2482ArduinoClock (the default) reads millis()
+ * and micros(); the clocks here replace it off the target:
+ *
+ *   DS2482VirtualClock  time only moves when something waits on it, so a
+ *                       simulated bus runs as fast as the host can execute
+ *                       it, with exact and repeatable timing
+ *   DS2482SteadyClock   std::chrono::steady_clock, for host builds that
+ *                       should run in real time (only where <chrono> exists)
+ *
+ * Give the driver and the simulator the same clock:
+ *
+ *   DS2482VirtualClock virtualClock;
+ *   DS2482Sim sim(0x18, &virtualClock);
+ *   DS2482 ds2482(0x18, &sim, &virtualClock);
+ *   sim.setI2CClock(400000);    // Transactions advance the clock
+ *
+ * Every busy wait and every simulated I2C transfer advances virtual time by
+ * its duration. Polling loops that only read the clock need either a
+ * simulated bus with setI2CClock() or setAutoAdvance(), or they never see
+ * time pass.
+ */
+
+#ifndef DS2482_CLOCK_H
+#define DS2482_CLOCK_H
+
+#include "DS2482.h"
+
+#if defined(__has_include)
+#if __has_include(<chrono>)
+#define DS2482_HAS_STEADY_CLOCK 1
+#endif
+#endif
+
+// Clock that only advances when waited on or advanced explicitly
+class DS2482VirtualClock : public DS2482Clock {
+public:
+    DS2482VirtualClock(uint64_t startMicros = 0) : now(startMicros), step(0) {}
+
+    // DS2482Clock
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delayMicroseconds(uint32_t us) override { now += us; }
+
+    // Control
+    void advance(uint32_t us) { now += us; }            // Let time pass
+    void set(uint64_t micros) { now = micros; }         // Jump, e.g. to just before the millis() wrap
+    uint64_t getTime() { return now; }                  // Microseconds since time zero, never wraps
+    void setAutoAdvance(uint32_t us) { step = us; }     // Time every millis()/micros() call takes, 0 = none
+
+private:
+    uint64_t now;               // Microseconds since time zero
+    uint32_t step;
+};
+
+#if DS2482_HAS_STEADY_CLOCK
+// Real time on a host, from std::chrono::steady_clock
+class DS2482SteadyClock : public DS2482Clock {
+public:
+    DS2482SteadyClock();
+
+    // DS2482Clock
+    uint32_t millis() override { return (uint32_t)(elapsed() / 1000); }
+    uint32_t micros() override { return (uint32_t)elapsed(); }
+    void delayMicroseconds(uint32_t us) override;
+
+private:
+    int64_t origin;             // steady_clock time of construction, microseconds
+
+    uint64_t elapsed();
+};
+#endif
+
+#endif // DS2482_CLOCK_H
@@ -0,0 +1,319 @@
+/**
+ * APADevices - DS2482CostModel.cpp - Sweep latency prediction for a DS2482 topology
+ *
+ * Each prediction mirrors the corresponding driver routine transaction by
+ * transaction. Status polling is modelled the way the driver performs it:
+ * one status read per poll, DS2482_POLL_INTERVAL_US between polls, until the
+ * modelled 1-Wire busy time has elapsed. Only the first poll after a command
+ * that left the read pointer elsewhere pays for Set Read Pointer.
+ */
+
+#include "DS2482CostModel.h"
+
+/**
+ * Constructor - empty topology
+ * @param i2cClockHz I2C clock frequency
+ * @param overdrive true to model 1-Wire overdrive speed
+ */
+DS2482CostModel::DS2482CostModel(uint32_t i2cClockHz, bool overdrive) :
+    i2cClock(i2cClockHz),
+    overdrive(overdrive),
+    channelMask(0),
+    conversionTime(DS2482_CONVERSION_TIME_MS),
+    pending(false),
+    pendingBusy(0),
+    selected(DS2482_CHANNEL_UNKNOWN),
+    readPointer(DS2482_REG_UNKNOWN) {
+    for (uint8_t i = 0; i < 8; i++) {
+        family[i] = DS2482_FAMILY_DS18B20;
+        resolution[i] = 12;
+    }
+}
+
+/**
+ * Forget the modelled bridge state; the next prediction starts cold
+ */
+void DS2482CostModel::forgetState() {
+    pending = false;
+    pendingBusy = 0;
+    selected = DS2482_CHANNEL_UNKNOWN;
+    readPointer = DS2482_REG_UNKNOWN;
+}
+
+/**
+ * Populate a channel
+ * @param channel Channel number (0-7)
+ * @param family Sensor family code (DS2482_FAMILY_*)
+ * @param resolution Conversion resolution in bits (9-12)
+ */
+void DS2482CostModel::setSensor(uint8_t channel, uint8_t family, uint8_t resolution) {
+    if (channel > 7) {
+        return;
+    }
+    this->family[channel] = family;
+    this->resolution[channel] = constrain(resolution, 9, 12);
+    channelMask |= (1 << channel);
+}
+
+/**
+ * Remove a channel from the topology
+ * @param channel Channel number (0-7)
+ */
+void DS2482CostModel::removeSensor(uint8_t channel) {
+    if (channel <= 7) {
+        channelMask &= ~(1 << channel);
+    }
+}
+
+/**
+ * Conversion time of a sensor
+ * @param family Sensor family code
+ * @param resolution Conversion resolution in bits (9-12)
+ * @return Conversion time in microseconds
+ */
+uint32_t DS2482CostModel::conversionMicros(uint8_t family, uint8_t resolution) {
+    uint32_t full = DS2482_CONVERSION_TIME_MS * 1000UL;
+    if (family == DS2482_FAMILY_DS18S20) {
+        return full;
+    }
+    return full >> (12 - constrain(resolution, 9, 12));
+}
+
+/**
+ * Conversion time that covers every populated sensor
+ * The shortest wait a driver sampling this population can be configured with.
+ * @return Conversion time in milliseconds, 0 if no channel is populated
+ */
+uint16_t DS2482CostModel::slowestConversionTime() {
+    uint32_t slowest = 0;
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        if (channelMask & (1 << channel)) {
+            slowest = max(slowest, conversionMicros(family[channel], resolution[channel]));
+        }
+    }
+    return (slowest + 999) / 1000;
+}
+
+/**
+ * Channel select with readback verification
+ * The driver only waits for a 1-Wire command that may still run; an already
+ * selected channel costs nothing more.
+ * @param channel Channel number (0-7)
+ */
+DS2482Prediction DS2482CostModel::selectChannel(uint8_t channel) {
+    DS2482Prediction cost = {0, 0, 0};
+    waitIfPending(cost);
+    if (channel == selected) {
+        return cost;
+    }
+    transaction(cost, 2);                       // Channel select command
+    readPointer = DS2482_CHANNEL_READBACK;
+    cost.micros += DS2482_CHANNEL_SETTLE_US;
+    transaction(cost, 1);                       // Read back
+    selected = channel;
+    return cost;
+}
+
+/**
+ * 1-Wire reset including presence polling
+ */
+DS2482Prediction DS2482CostModel::wireReset() {
+    DS2482Prediction cost = {0, 0, 0};
+    waitIfPending(cost);
+    transaction(cost, 1);
+    readPointer = DS2482_REG_STATUS;
+    waitFor1Wire(cost, overdrive ? DS2482_1W_OD_RESET_US : DS2482_1W_RESET_US);
+    return cost;
+}
+
+/**
+ * 1-Wire byte read: wait if still busy, read command, wait, fetch data register
+ */
+DS2482Prediction DS2482CostModel::wireReadByte() {
+    DS2482Prediction cost = {0, 0, 0};
+    waitIfPending(cost);
+    transaction(cost, 1);
+    readPointer = DS2482_REG_STATUS;
+    waitFor1Wire(cost, 8 * slotMicros());
+    pointTo(cost, DS2482_REG_DATA);
+    transaction(cost, 1);
+    return cost;
+}
+
+/**
+ * Select, 1-Wire reset, Skip ROM, Convert T
+ * The final byte is still on the wire when the call returns; it overlaps the
+ * conversion wait and is not charged.
+ * @param channel Channel number (0-7)
+ */
+DS2482Prediction DS2482CostModel::startTemperatureConversion(uint8_t channel) {
+    DS2482Prediction cost = selectChannel(channel);
+    cost.add(wireReset());
+    wireWriteByte(cost);
+    wireWriteByte(cost);
+    return cost;
+}
+
+/**
+ * Select, 1-Wire reset, Skip ROM, Read Scratchpad, 9 byte reads
+ * @param channel Channel number (0-7)
+ */
+DS2482Prediction DS2482CostModel::readTemperature(uint8_t channel) {
+    DS2482Prediction cost = selectChannel(channel);
+    cost.add(wireReset());
+    wireWriteByte(cost);
+    wireWriteByte(cost);
+    for (uint8_t i = 0; i < 9; i++) {
+        cost.add(wireReadByte());
+    }
+    return cost;
+}
+
+/**
+ * Complete acquisition of one sensor
+ * The driver waits its configured conversion time whatever the sensor's
+ * resolution, so the model does too.
+ * @param channel Channel number (0-7)
+ */
+DS2482Prediction DS2482CostModel::predictAcquisition(uint8_t channel) {
+    DS2482Prediction cost = startTemperatureConversion(channel);
+    cost.micros += (uint32_t)conversionTime * 1000;
+    pendingBusy = 0;    // Convert T finished long ago, but is still polled once
+    cost.add(readTemperature(channel));
+    return cost;
+}
+
+/**
+ * Sequential sweep over all populated channels, as repeated continuously
+ * Runs on a copy of the model that has done one sweep already, so the
+ * result does not depend on earlier predictions.
+ */
+DS2482Prediction DS2482CostModel::predictSweep() const {
+    DS2482CostModel model = *this;
+    model.forgetState();
+    model.sweepFrom(0);
+    return model.sweepFrom(0);
+}
+
+/**
+ * Sample rate of a sensor when all populated channels are swept continuously
+ * The period is the time from the start of the sensor's acquisition to the
+ * start of its next one, with the sweep already running.
+ * @return Rate in mHz, 0 if the channel is not populated
+ */
+uint32_t DS2482CostModel::maxSampleRateMilliHz(uint8_t channel) const {
+    if (channel > 7 || !(channelMask & (1 << channel))) {
+        return 0;
+    }
+    DS2482CostModel model = *this;
+    model.forgetState();
+    model.sweepFrom(0);
+    uint32_t period = model.sweepFrom(channel).micros;
+    return period ? 1000000000UL / period : 0;
+}
+
+/**
+ * Sample rate of a sensor if it were the only one being acquired
+ * Like maxSampleRateMilliHz(), with one acquisition already done.
+ * @return Rate in mHz, 0 if the channel is not populated
+ */
+uint32_t DS2482CostModel::standaloneRateMilliHz(uint8_t channel) const {
+    if (channel > 7 || !(channelMask & (1 << channel))) {
+        return 0;
+    }
+    DS2482CostModel model = *this;
+    model.forgetState();
+    model.predictAcquisition(channel);
+    uint32_t acquisition = model.predictAcquisition(channel).micros;
+    return acquisition ? 1000000000UL / acquisition : 0;
+}
+
+/**
+ * One acquisition of every populated channel, continuing from the model state
+ * @param first Channel to start with; the others follow in order, wrapping
+ *              around after channel 7
+ */
+DS2482Prediction DS2482CostModel::sweepFrom(uint8_t first) {
+    DS2482Prediction cost = {0, 0, 0};
+    for (uint8_t i = 0; i < 8; i++) {
+        uint8_t channel = (first + i) & 0x07;
+        if (channelMask & (1 << channel)) {
+            cost.add(predictAcquisition(channel));
+        }
+    }
+    return cost;
+}
+
+/**
+ * Charge one I2C transaction
+ * @param length Payload bytes, excluding the address byte
+ */
+void DS2482CostModel::transaction(DS2482Prediction& cost, uint8_t length) {
+    uint32_t bits = (uint32_t)(length + 1) * DS2482_I2C_BITS_PER_BYTE + DS2482_I2C_BITS_PER_FRAME;
+    uint32_t time = i2cClock ? (bits * 1000000UL) / i2cClock : 0;
+    cost.micros += time;
+    cost.busMicros += time;
+    cost.transactions++;
+}
+
+/**
+ * Status read as issued by readStatus()
+ */
+void DS2482CostModel::statusRead(DS2482Prediction& cost) {
+    pointTo(cost, DS2482_REG_STATUS);
+    transaction(cost, 1);
+}
+
+/**
+ * Move the read pointer, as setReadPointer() does only when needed
+ * @param reg Register to read next
+ */
+void DS2482CostModel::pointTo(DS2482Prediction& cost, uint8_t reg) {
+    if (readPointer != reg) {
+        transaction(cost, 2);
+        readPointer = reg;
+    }
+}
+
+/**
+ * Poll the status register until the given busy time has elapsed
+ * The driver always reads the status at least once.
+ * @param busyMicros 1-Wire busy time remaining when polling starts
+ */
+void DS2482CostModel::waitFor1Wire(DS2482Prediction& cost, uint32_t busyMicros) {
+    uint32_t elapsed = 0;
+    while (true) {
+        DS2482Prediction poll = {0, 0, 0};
+        statusRead(poll);
+        cost.add(poll);
+        elapsed += poll.micros;
+        if (elapsed >= busyMicros) {
+            break;
+        }
+        cost.micros += DS2482_POLL_INTERVAL_US;
+        elapsed += DS2482_POLL_INTERVAL_US;
+    }
+}
+
+/**
+ * 1-Wire byte write: wait if still busy, then issue the write command
+ */
+void DS2482CostModel::wireWriteByte(DS2482Prediction& cost) {
+    waitIfPending(cost);
+    transaction(cost, 2);
+    readPointer = DS2482_REG_STATUS;
+    pending = true;
+    pendingBusy = 8 * slotMicros();
+}
+
+/**
+ * Wait for the last 1-Wire write, as waitIfWirePending() does: at least one
+ * status poll, however long ago the write went out
+ */
+void DS2482CostModel::waitIfPending(DS2482Prediction& cost) {
+    if (pending) {
+        waitFor1Wire(cost, pendingBusy);
+        pending = false;
+        pendingBusy = 0;
+    }
+}
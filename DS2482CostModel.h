@@ -0,0 +1,104 @@
+/**
+ * APADevices - DS2482CostModel.h - Sweep latency prediction for a DS2482 topology
+ *
+ * DS2482CostModel predicts how long the driver needs to sample a given
+ * channel population, before any hardware is deployed. It replays the exact
+ * sequence of I2C transactions, settle delays and status polls the driver
+ * issues (using the same timing constants as waitFor1Wire() and
+ * checkConversionStatus()) and adds the 1-Wire times and the conversion
+ * wait. Like the driver, the model waits one conversion time for every
+ * sensor; set it to the same value as DS2482::setConversionTime().
+ *
+ * The modelled sweep is the sequential one used by the examples: for every
+ * populated channel start a conversion, wait for it, then read the result.
+ *
+ * Like the driver, the model remembers the selected channel and the read
+ * pointer, so every per-operation prediction continues from the bridge
+ * state the previous one left: selecting the channel that is already
+ * selected costs nothing, and Set Read Pointer is only charged when the
+ * pointer moves. The sweep and rate predictions do not use or change that
+ * state; they model sampling that is already running.
+ *
+ *   DS2482CostModel model(400000);
+ *   model.setSensor(0, DS2482_FAMILY_DS18B20, 12);
+ *   model.setSensor(1, DS2482_FAMILY_DS18B20, 10);
+ *   model.setConversionTime(model.slowestConversionTime());
+ *   DS2482Prediction sweep = model.predictSweep();
+ */
+
+#ifndef DS2482_COST_MODEL_H
+#define DS2482_COST_MODEL_H
+
+#include "DS2482.h"
+
+// 1-Wire family codes of the supported temperature sensors
+#define DS2482_FAMILY_DS18S20  0x10    // Fixed 9-bit, always 750 ms conversion
+#define DS2482_FAMILY_DS1822   0x22    // 9-12 bit, DS18B20 timing
+#define DS2482_FAMILY_DS18B20  0x28    // 9-12 bit
+
+// Predicted cost of an operation or a sequence of operations
+struct DS2482Prediction {
+    uint32_t micros;        // Total elapsed time
+    uint32_t busMicros;     // Part of it spent transferring on I2C
+    uint32_t transactions;  // I2C transactions issued
+
+    void add(const DS2482Prediction& other) {
+        micros += other.micros;
+        busMicros += other.busMicros;
+        transactions += other.transactions;
+    }
+};
+
+class DS2482CostModel {
+public:
+    DS2482CostModel(uint32_t i2cClockHz = 100000, bool overdrive = false);
+
+    // Topology
+    void setI2CClock(uint32_t clockHz) { i2cClock = clockHz; }
+    void setOverdrive(bool enabled) { overdrive = enabled; }
+    void setSensor(uint8_t channel, uint8_t family = DS2482_FAMILY_DS18B20, uint8_t resolution = 12);
+    void removeSensor(uint8_t channel);
+    uint8_t getChannelMask() { return channelMask; }
+    void setConversionTime(uint16_t ms) { conversionTime = ms; }  // Wait the driver is configured with
+    uint16_t getConversionTime() { return conversionTime; }
+    uint16_t slowestConversionTime();                  // Longest conversion of the populated sensors, ms
+
+    // Per-operation predictions, matching the driver call of the same name
+    DS2482Prediction selectChannel(uint8_t channel);
+    DS2482Prediction wireReset();
+    DS2482Prediction wireReadByte();
+    DS2482Prediction startTemperatureConversion(uint8_t channel);
+    DS2482Prediction readTemperature(uint8_t channel);
+    void forgetState();     // Bridge state unknown, as after begin() on another driver
+
+    // Topology level predictions
+    DS2482Prediction predictAcquisition(uint8_t channel);  // Start, conversion wait and read of one sensor
+    DS2482Prediction predictSweep() const;                 // Acquisition of every populated channel
+    uint32_t maxSampleRateMilliHz(uint8_t channel) const;   // Rate the sensor achieves in continuous sweeps
+    uint32_t standaloneRateMilliHz(uint8_t channel) const;  // Rate if the sensor were sampled on its own
+
+    static uint32_t conversionMicros(uint8_t family, uint8_t resolution);
+
+private:
+    uint32_t i2cClock;
+    bool overdrive;
+    uint8_t channelMask;
+    uint8_t family[8];
+    uint8_t resolution[8];
+    uint16_t conversionTime;    // Conversion wait in ms, as DS2482::getConversionTime()
+    bool pending;           // A 1-Wire write went out and no status poll has seen it finish
+    uint32_t pendingBusy;   // Its busy time left
+    uint8_t selected;       // Channel the modelled driver has selected
+    uint8_t readPointer;    // Register the modelled bridge returns on a read
+
+    DS2482Prediction sweepFrom(uint8_t first);   // Acquisitions from first on, wrapping around
+    void transaction(DS2482Prediction& cost, uint8_t length);
+    void statusRead(DS2482Prediction& cost);
+    void pointTo(DS2482Prediction& cost, uint8_t reg);
+    void waitFor1Wire(DS2482Prediction& cost, uint32_t busyMicros);
+    void wireWriteByte(DS2482Prediction& cost);
+    void waitIfPending(DS2482Prediction& cost);
+    uint32_t slotMicros() { return overdrive ? DS2482_1W_OD_SLOT_US : DS2482_1W_SLOT_US; }
+};
+
+#endif
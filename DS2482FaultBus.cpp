@@ -0,0 +1,213 @@
+/**
+ * APADevices - DS2482FaultBus.cpp - Fault-injecting DS2482 transport
+ *
+ * The wrapper follows the read pointer from the commands it forwards, so it
+ * knows whether a read returns the status, data, channel or configuration
+ * register and only tampers with the register a fault applies to.
+ */
+
+#include "DS2482FaultBus.h"
+
+// Wire style result of a NACKed address byte
+#define FAULT_NACK_ADDRESS  2
+#define FAULT_BUS_ERROR     4
+
+static DS2482ArduinoClock defaultClock;
+
+/**
+ * Constructor
+ * @param target Transport the traffic is forwarded to
+ * @param seed Seed of the fault schedule; 0 is replaced by 1
+ * @param clock Time base, nullptr for the Arduino clock
+ */
+DS2482FaultBus::DS2482FaultBus(DS2482Bus& target, uint32_t seed, DS2482Clock* clock) :
+    target(target),
+    clock(clock ? clock : &defaultClock),
+    enabled(true),
+    readPointer(DS2482_REG_STATUS),
+    holding(false),
+    holdStart(0),
+    holdTime(DS2482_FAULT_HOLD_US),
+    presenceLost(false),
+    stuck(false) {
+    for (uint8_t i = 0; i < DS2482_FAULT_COUNT; i++) {
+        rates[i] = 0;
+    }
+    setSeed(seed);
+    resetCounters();
+}
+
+/**
+ * Restart the fault sequence from a seed
+ * @param seed Any value; 0 is replaced by 1
+ */
+void DS2482FaultBus::setSeed(uint32_t seed) {
+    state = seed ? seed : 1;
+    holding = false;
+    presenceLost = false;
+    stuck = false;
+}
+
+/**
+ * Set how often a fault is injected
+ * @param fault Fault type
+ * @param rate Faults per 10000 opportunities (0 disables, 10000 = always)
+ */
+void DS2482FaultBus::setRate(DS2482Fault fault, uint16_t rate) {
+    rates[(uint8_t)fault] = rate > DS2482_FAULT_RATE_SCALE ? DS2482_FAULT_RATE_SCALE : rate;
+}
+
+/**
+ * Total number of injected faults of all types
+ * @return Sum of all counters
+ */
+uint32_t DS2482FaultBus::getInjectedTotal() {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < DS2482_FAULT_COUNT; i++) {
+        total += injected[i];
+    }
+    return total;
+}
+
+/**
+ * Clear the injected fault counters
+ */
+void DS2482FaultBus::resetCounters() {
+    for (uint8_t i = 0; i < DS2482_FAULT_COUNT; i++) {
+        injected[i] = 0;
+    }
+}
+
+/**
+ * Forward a write, possibly dropping it with a NACK
+ * @return 0 on ACK, Wire error code otherwise
+ */
+uint8_t DS2482FaultBus::write(uint8_t address, const uint8_t* data, uint8_t length) {
+    if (stuck) {
+        return FAULT_BUS_ERROR;
+    }
+    if (enabled && length > 0 && inject(DS2482Fault::NACK)) {
+        return FAULT_NACK_ADDRESS;
+    }
+    if (enabled && length > 0 && inject(DS2482Fault::STUCK_BUS)) {
+        stuck = true;
+        return FAULT_BUS_ERROR;
+    }
+
+    uint8_t result = target.write(address, data, length);
+    if (result == 0 && length > 0) {
+        trackWrite(data, length);
+    }
+    return result;
+}
+
+/**
+ * Forward a read and tamper with the bytes received
+ * @return Number of bytes received
+ */
+uint8_t DS2482FaultBus::read(uint8_t address, uint8_t* data, uint8_t length) {
+    if (stuck) {
+        return 0;
+    }
+    uint8_t received = target.read(address, data, length);
+    if (!enabled) {
+        return received;
+    }
+
+    for (uint8_t i = 0; i < received; i++) {
+        if (readPointer == DS2482_REG_STATUS) {
+            if (holding) {
+                if (clock->micros() - holdStart < holdTime) {
+                    data[i] |= DS2482_STATUS_1WB;
+                } else {
+                    holding = false;
+                }
+            }
+            if (presenceLost) {
+                data[i] &= ~DS2482_STATUS_PPD;
+            }
+        } else if (readPointer == DS2482_REG_DATA && inject(DS2482Fault::CORRUPT_READ)) {
+            data[i] ^= 1 << (nextRandom() & 0x07);
+        }
+    }
+    return received;
+}
+
+/**
+ * Release an injected stuck bus, or pass the request on
+ * @return true if SDA was stuck
+ */
+bool DS2482FaultBus::clearBus() {
+    if (stuck) {
+        stuck = false;
+        return true;
+    }
+    return target.clearBus();
+}
+
+/**
+ * Follow the read pointer and arm the 1-Wire faults
+ * @param data Acknowledged command bytes
+ * @param length Number of bytes
+ */
+void DS2482FaultBus::trackWrite(const uint8_t* data, uint8_t length) {
+    switch (data[0]) {
+        case DS2482_CMD_SET_READ:
+            if (length > 1) {
+                readPointer = data[1];
+            }
+            break;
+
+        case DS2482_CMD_RESET:
+            readPointer = DS2482_REG_STATUS;
+            holding = false;
+            presenceLost = false;
+            break;
+
+        case DS2482_CMD_WRITE_CONFIG:
+            readPointer = DS2482_REG_CONFIG;
+            break;
+
+        case DS2482_CMD_CHANNEL_SELECT:
+            readPointer = DS2482_CHANNEL_READBACK;
+            break;
+
+        case DS2482_CMD_WIRE_RESET:
+        case DS2482_CMD_WRITE_BYTE:
+        case DS2482_CMD_READ_BYTE:
+        case DS2482_CMD_SINGLE_BIT:
+            readPointer = DS2482_REG_STATUS;
+            presenceLost = (data[0] == DS2482_CMD_WIRE_RESET) && enabled &&
+                           inject(DS2482Fault::CLEAR_PRESENCE);
+            if (!holding && enabled && inject(DS2482Fault::HOLD_BUSY)) {
+                holding = true;
+                holdStart = clock->micros();
+            }
+            break;
+    }
+}
+
+/**
+ * Decide whether to inject a fault at this opportunity
+ * @param fault Fault type
+ * @return true if the fault should be injected
+ */
+bool DS2482FaultBus::inject(DS2482Fault fault) {
+    uint16_t rate = rates[(uint8_t)fault];
+    if (rate == 0 || nextRandom() % DS2482_FAULT_RATE_SCALE >= rate) {
+        return false;
+    }
+    injected[(uint8_t)fault]++;
+    return true;
+}
+
+/**
+ * Next value of the xorshift32 generator
+ * @return Pseudo-random 32-bit value
+ */
+uint32_t DS2482FaultBus::nextRandom() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
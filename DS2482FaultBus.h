@@ -0,0 +1,82 @@
+/**
+ * APADevices - DS2482FaultBus.h - Fault-injecting DS2482 transport
+ *
+ * DS2482FaultBus sits between the driver and another transport (the real
+ * DS2482WireBus or DS2482Sim) and injects failures on a seeded, repeatable
+ * schedule, so recovery paths can be exercised and benchmarked on demand:
+ *
+ *   NACK             a write is not forwarded and reports an address NACK
+ *   CORRUPT_READ     one bit of a byte read from the data register is flipped
+ *   HOLD_BUSY        after a 1-Wire command, status reads keep 1WB set for a while
+ *   CLEAR_PRESENCE   after a 1-Wire reset, status reads show no presence pulse
+ *   STUCK_BUS        a write is cut off mid-byte and SDA stays low until clearBus()
+ *
+ * Each fault has a rate in faults per 10000 opportunities. The same seed
+ * produces the same fault sequence for the same traffic.
+ *
+ *   DS2482Sim sim;
+ *   DS2482FaultBus faults(sim, 1234);
+ *   DS2482 ds2482(0x18, &faults);
+ *   faults.setRate(DS2482Fault::CORRUPT_READ, 50);   // 0.5 % of data reads
+ */
+
+#ifndef DS2482_FAULT_BUS_H
+#define DS2482_FAULT_BUS_H
+
+#include "DS2482.h"
+
+#define DS2482_FAULT_COUNT       5
+#define DS2482_FAULT_RATE_SCALE  10000   // Rates are per 10000 opportunities
+#define DS2482_FAULT_HOLD_US     150000  // Default 1WB hold, longer than DS2482_TIMEOUT_MS
+
+// Injectable failures
+enum class DS2482Fault : uint8_t {
+    NACK,               // Write not acknowledged
+    CORRUPT_READ,       // Bit flip in a data register read
+    HOLD_BUSY,          // 1WB stuck after a 1-Wire command
+    CLEAR_PRESENCE,     // PPD cleared after a 1-Wire reset
+    STUCK_BUS           // SDA held low until the bus is cleared
+};
+
+class DS2482FaultBus : public DS2482Bus {
+public:
+    DS2482FaultBus(DS2482Bus& target, uint32_t seed = 1, DS2482Clock* clock = nullptr);
+
+    // DS2482Bus transport
+    void begin() override { target.begin(); }
+    uint8_t write(uint8_t address, const uint8_t* data, uint8_t length) override;
+    uint8_t read(uint8_t address, uint8_t* data, uint8_t length) override;
+    bool clearBus() override;
+
+    // Schedule
+    void setSeed(uint32_t seed);                            // Restart the fault sequence
+    void setRate(DS2482Fault fault, uint16_t rate);         // Faults per 10000 opportunities
+    uint16_t getRate(DS2482Fault fault) { return rates[(uint8_t)fault]; }
+    void setHoldTime(uint32_t us) { holdTime = us; }        // Duration of a HOLD_BUSY fault
+    void setEnabled(bool enabled) { this->enabled = enabled; }  // Pass traffic through untouched when false
+
+    // Results
+    uint32_t getInjected(DS2482Fault fault) { return injected[(uint8_t)fault]; }
+    uint32_t getInjectedTotal();
+    void resetCounters();
+
+private:
+    DS2482Bus& target;
+    DS2482Clock* clock;         // Time base of HOLD_BUSY
+    uint32_t state;             // xorshift32 state
+    uint16_t rates[DS2482_FAULT_COUNT];
+    uint32_t injected[DS2482_FAULT_COUNT];
+    bool enabled;
+    uint8_t readPointer;        // Register the target will return, tracked from writes
+    bool holding;               // HOLD_BUSY in effect
+    uint32_t holdStart;
+    uint32_t holdTime;
+    bool presenceLost;          // CLEAR_PRESENCE in effect until the next 1-Wire command
+    bool stuck;                 // STUCK_BUS in effect until clearBus()
+
+    bool inject(DS2482Fault fault);
+    uint32_t nextRandom();
+    void trackWrite(const uint8_t* data, uint8_t length);
+};
+
+#endif
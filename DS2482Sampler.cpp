@@ -0,0 +1,440 @@
+/**
+ * APADevices - DS2482Sampler.cpp - Non-blocking sampling engine for DS2482 channels
+ *
+ * Each update() performs at most one driver operation (start a conversion or
+ * read a finished one), so loop() stays responsive while a sweep is running.
+ */
+
+#include "DS2482Sampler.h"
+
+// Channel value while no sweep is in progress
+#define SAMPLER_NO_CHANNEL  0xFF
+
+/**
+ * Add a sample to the running statistics (Welford's online algorithm)
+ * @param raw Temperature in 1/16 °C
+ * @param timestamp millis() of the sample
+ */
+void DS2482SensorStats::add(int16_t raw, unsigned long timestamp) {
+    int32_t value = (int32_t)raw << 8;
+
+    if (count == 0) {
+        minRaw = raw;
+        maxRaw = raw;
+    } else {
+        if (raw < minRaw) minRaw = raw;
+        if (raw > maxRaw) maxRaw = raw;
+    }
+
+    count++;
+    int32_t delta = value - meanQ8;
+    int32_t half = (int32_t)(count / 2);
+    meanQ8 += (delta >= 0 ? delta + half : delta - half) / (int32_t)count;  // Rounded, avoids drift
+    m2Q16 += (int64_t)delta * (value - meanQ8);
+    lastUpdate = timestamp;
+}
+
+/**
+ * Forget all samples
+ */
+void DS2482SensorStats::clear() {
+    count = 0;
+    minRaw = 0;
+    maxRaw = 0;
+    meanQ8 = 0;
+    m2Q16 = 0;
+    lastUpdate = 0;
+}
+
+/**
+ * Sample variance of the accumulated temperatures
+ * @return Variance in °C^2, 0 with fewer than two samples
+ */
+float DS2482SensorStats::varianceCelsius() const {
+    if (count < 2 || m2Q16 <= 0) {
+        return 0.0;
+    }
+    // Q16 of (1/16 °C)^2 -> °C^2: divide by 2^16 * 16^2
+    return (float)(m2Q16 / (int64_t)(count - 1)) / 16777216.0;
+}
+
+/**
+ * Set up the filter chain and clear its state
+ * @param rejectInvalid Drop power-on (85.00 °C) and disconnected (-127.00 °C) values
+ * @param medianTaps Median window length: 0 (off), 3 or 5
+ * @param emaShift EMA smoothing, alpha = 1 / 2^emaShift; 0 disables the EMA
+ * @param maxStep Largest accepted change per sample in 1/16 °C, 0 = unlimited
+ */
+void DS2482Filter::configure(bool rejectInvalid, uint8_t medianTaps, uint8_t emaShift, int16_t maxStep) {
+    this->rejectInvalid = rejectInvalid;
+    this->medianTaps = (medianTaps >= 5) ? 5 : (medianTaps >= 3 ? 3 : 0);
+    this->emaShift = emaShift > 15 ? 15 : emaShift;
+    this->maxStep = maxStep < 0 ? 0 : maxStep;
+    clear();
+}
+
+/**
+ * Forget the filter history, keeping the configuration
+ */
+void DS2482Filter::clear() {
+    windowCount = 0;
+    windowIndex = 0;
+    primed = false;
+    last = 0;
+    emaQ8 = 0;
+    rejected = 0;
+}
+
+/**
+ * Run one raw sample through the filter chain
+ * @param raw Temperature in 1/16 °C as read
+ * @param value Receives the filtered temperature in 1/16 °C
+ * @return false if the sample was rejected as invalid
+ */
+bool DS2482Filter::apply(int16_t raw, int16_t* value) {
+    if (rejectInvalid && (raw == DS2482_RAW_POWER_ON || raw == DS2482_RAW_DISCONNECTED)) {
+        if (rejected < 0xFFFF) {
+            rejected++;
+        }
+        return false;
+    }
+
+    int16_t x = raw;
+
+    if (medianTaps) {
+        window[windowIndex] = raw;
+        windowIndex = (windowIndex + 1) % medianTaps;
+        if (windowCount < medianTaps) {
+            windowCount++;
+        }
+
+        // Insertion sort of at most 5 values
+        int16_t sorted[5];
+        for (uint8_t i = 0; i < windowCount; i++) {
+            int16_t v = window[i];
+            uint8_t j = i;
+            while (j > 0 && sorted[j - 1] > v) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        x = sorted[(windowCount - 1) / 2];
+    }
+
+    if (!primed) {
+        primed = true;
+        last = x;
+        emaQ8 = (int32_t)x << 8;
+        *value = x;
+        return true;
+    }
+
+    if (maxStep) {
+        if (x > last + maxStep) {
+            x = last + maxStep;
+        } else if (x < last - maxStep) {
+            x = last - maxStep;
+        }
+    }
+    last = x;
+
+    if (emaShift) {
+        emaQ8 += (((int32_t)x << 8) - emaQ8) >> emaShift;
+        x = (int16_t)((emaQ8 + 128) >> 8);
+    }
+
+    *value = x;
+    return true;
+}
+
+/**
+ * Set the reporting policy and forget the last reported value
+ * @param deadband Minimum change to report in 1/16 °C, 0 reports every sample
+ * @param heartbeat Longest silence in ms before a sample is reported anyway, 0 = none
+ */
+void DS2482Report::configure(int16_t deadband, unsigned long heartbeat) {
+    this->deadband = deadband < 0 ? 0 : deadband;
+    this->heartbeat = heartbeat;
+    clear();
+}
+
+/**
+ * Forget the last reported value, keeping the configuration
+ */
+void DS2482Report::clear() {
+    reported = false;
+    lastValue = 0;
+    lastTime = 0;
+    suppressed = 0;
+}
+
+/**
+ * Decide whether a sample is worth reporting and record it if so
+ * @param value Temperature in 1/16 °C
+ * @param now Current millis()
+ * @return true if the sample should be passed on
+ */
+bool DS2482Report::check(int16_t value, unsigned long now) {
+    int16_t change = value > lastValue ? value - lastValue : lastValue - value;
+    bool report = !reported ||
+                  change >= deadband ||
+                  (heartbeat && now - lastTime >= heartbeat);
+
+    if (!report) {
+        if (suppressed < 0xFFFF) {
+            suppressed++;
+        }
+        return false;
+    }
+
+    reported = true;
+    lastValue = value;
+    lastTime = now;
+    suppressed = 0;
+    return true;
+}
+
+/**
+ * Constructor
+ * @param bridge Initialized DS2482 the sensors are connected to
+ */
+DS2482Sampler::DS2482Sampler(DS2482& bridge) :
+    bridge(bridge),
+    channelMask(0),
+    interval(0),
+    sweepStart(0),
+    channel(SAMPLER_NO_CHANNEL),
+    converting(false),
+    swept(false),
+    maxRetries(1),
+    retries(0),
+    retryCount(0),
+    failureStreak(0),
+    stats(nullptr),
+    filters(nullptr),
+    reports(nullptr) {
+    for (uint8_t i = 0; i < 8; i++) {
+        errors[i] = 0;
+    }
+}
+
+/**
+ * Advance the sampling state machine by one step
+ * Call this from loop() as often as possible.
+ * @param sample Receives the sample when one is completed
+ * @return true if a new sample was written to sample
+ */
+bool DS2482Sampler::update(DS2482Sample* sample) {
+    if (!converting) {
+        if (channel == SAMPLER_NO_CHANNEL) {
+            if (!channelMask || (swept && bridge.getClock().millis() - sweepStart < interval)) {
+                return false;
+            }
+            sweepStart = bridge.getClock().millis();
+            swept = true;
+            nextChannel();
+        }
+
+        if (bridge.startTemperatureConversion(channel)) {
+            converting = true;
+        } else {
+            channelFailed();
+        }
+        return false;
+    }
+
+    if (!bridge.isBusy()) {
+        // Conversion state lost, e.g. cleared by the application
+        channelFailed();
+        return false;
+    }
+
+    if (!bridge.checkConversionStatus()) {
+        return false;
+    }
+
+    int16_t raw;
+    if (!bridge.readTemperatureRaw(channel, &raw)) {
+        DS2482Frame frame = bridge.getLastFrame();
+        bool genuine = (frame == DS2482Frame::POWER_ON_RESET && retries > 0);
+        if (!genuine) {
+            if (frame != DS2482Frame::NONE && frame != DS2482Frame::BUS_ERROR && retries < maxRetries) {
+                // Bad frame but working bus: reconvert this sensor only
+                retries++;
+                if (retryCount < 0xFFFF) {
+                    retryCount++;
+                }
+                converting = false;
+                return false;
+            }
+            channelFailed();
+            return false;
+        }
+    }
+
+    converting = false;
+    failureStreak = 0;
+    uint8_t sampled = channel;
+    nextChannel();
+
+    int16_t value = raw;
+    if (filters && !filters[sampled].apply(raw, &value)) {
+        return false;
+    }
+
+    sample->channel = sampled;
+    sample->raw = raw;
+    sample->value = value;
+    sample->timestamp = bridge.getClock().millis();
+    sample->startMicros = bridge.getConversionStartMicros();
+    sample->finishMicros = bridge.getConversionFinishMicros();
+
+    if (stats) {
+        stats[sampled].add(value, sample->timestamp);
+    }
+
+    if (reports && !reports[sampled].check(value, sample->timestamp)) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Time of the next step of the state machine
+ * A running conversion completes at its deadline in the driver, the next
+ * sweep starts one interval after the last one began; between the channels
+ * of a sweep there is work right away.
+ * @return millis() at which update() next has work, possibly already past;
+ *         DS2482_NEVER_MS from now if no channel is enabled
+ */
+unsigned long DS2482Sampler::nextEventAt() {
+    unsigned long now = bridge.getClock().millis();
+    if (converting) {
+        // update() notices right away if the conversion state was lost
+        return bridge.isBusy() ? bridge.getConversionDue(channel) : now;
+    }
+    if (channel != SAMPLER_NO_CHANNEL) {
+        return now;     // Next channel or a reconvert
+    }
+    if (!channelMask) {
+        return now + DS2482_NEVER_MS;
+    }
+    return swept ? sweepStart + interval : now;
+}
+
+/**
+ * Time the application can sleep before calling update() again
+ * @return Milliseconds until nextEventAt(), 0 if it has passed
+ */
+unsigned long DS2482Sampler::timeToNextEvent() {
+    long remaining = (long)(nextEventAt() - bridge.getClock().millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+/**
+ * Enable change-only reporting
+ * Call DS2482Report::configure() on each entry to set its deadband and heartbeat.
+ * @param reports Array of 8 entries owned by the caller, or nullptr to report every sample
+ */
+void DS2482Sampler::attachReports(DS2482Report* reports) {
+    this->reports = reports;
+}
+
+/**
+ * Reporting state of one sensor
+ * @param channel Channel number (0-7)
+ * @return Report policy, or nullptr if disabled or channel invalid
+ */
+DS2482Report* DS2482Sampler::getReport(uint8_t channel) {
+    if (!reports || channel > 7) {
+        return nullptr;
+    }
+    return &reports[channel];
+}
+
+/**
+ * Enable per-sensor filtering
+ * The filters are used as configured; call DS2482Filter::configure() on
+ * each entry before or after attaching.
+ * @param filters Array of 8 entries owned by the caller, or nullptr to disable
+ */
+void DS2482Sampler::attachFilters(DS2482Filter* filters) {
+    this->filters = filters;
+}
+
+/**
+ * Filter of one sensor
+ * @param channel Channel number (0-7)
+ * @return Filter, or nullptr if disabled or channel invalid
+ */
+DS2482Filter* DS2482Sampler::getFilter(uint8_t channel) {
+    if (!filters || channel > 7) {
+        return nullptr;
+    }
+    return &filters[channel];
+}
+
+/**
+ * Enable per-sensor statistics
+ * @param stats Array of 8 entries owned by the caller, or nullptr to disable
+ */
+void DS2482Sampler::attachStats(DS2482SensorStats* stats) {
+    this->stats = stats;
+    resetStats();
+}
+
+/**
+ * Statistics of one sensor
+ * @param channel Channel number (0-7)
+ * @return Statistics, or nullptr if disabled or channel invalid
+ */
+const DS2482SensorStats* DS2482Sampler::getStats(uint8_t channel) {
+    if (!stats || channel > 7) {
+        return nullptr;
+    }
+    return &stats[channel];
+}
+
+/**
+ * Clear the statistics of all sensors
+ */
+void DS2482Sampler::resetStats() {
+    if (!stats) {
+        return;
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        stats[i].clear();
+    }
+}
+
+/**
+ * Move to the next enabled channel of the sweep
+ * @return false when the sweep is complete
+ */
+bool DS2482Sampler::nextChannel() {
+    retries = 0;
+    for (uint8_t next = (uint8_t)(channel + 1); next < 8; next++) {
+        if (channelMask & (1 << next)) {
+            channel = next;
+            return true;
+        }
+    }
+    channel = SAMPLER_NO_CHANNEL;
+    return false;
+}
+
+/**
+ * Record a failure on the current channel and skip to the next one
+ */
+void DS2482Sampler::channelFailed() {
+    if (errors[channel] < 255) {
+        errors[channel]++;
+    }
+    if (failureStreak < 0xFFFF) {
+        failureStreak++;
+    }
+    converting = false;
+    bridge.clearState();
+    nextChannel();
+}
@@ -0,0 +1,173 @@
+/**
+ * APADevices - DS2482Sampler.h - Non-blocking sampling engine for DS2482 channels
+ *
+ * DS2482Sampler runs the convert / wait / read cycle over a set of channels
+ * from loop(), one step per update() call, and hands out each completed
+ * sample. It replaces the hand-written state machines of the examples:
+ *
+ *   DS2482Sampler sampler(ds2482);
+ *   sampler.setChannels(0xFF);          // all 8 channels
+ *
+ *   void loop() {
+ *       DS2482Sample sample;
+ *       if (sampler.update(&sample)) {
+ *           // sample.channel, sample.celsius()
+ *       }
+ *   }
+ *
+ * Per-sensor running statistics (count, min, max, mean, variance) can be
+ * enabled by attaching storage for 8 DS2482SensorStats with attachStats().
+ * They are maintained with Welford's algorithm in integer arithmetic, so no
+ * sample history is kept and the footprint is fixed.
+ *
+ * Per-sensor filters (invalid value rejection, median spike rejection, rate
+ * limiting and an exponential moving average) run on the raw 1/16 °C counts
+ * as samples arrive when storage for 8 DS2482Filter is attached with
+ * attachFilters(). Statistics are computed on the filtered values.
+ *
+ * Change-only reporting: with storage for 8 DS2482Report attached through
+ * attachReports(), update() only returns a sample when it moved by at least
+ * the sensor's deadband since the last reported value, or when the sensor
+ * has been silent for its heartbeat interval. Statistics still see every
+ * sample.
+ *
+ * Between steps the engine has nothing to do until a conversion completes or
+ * the next sweep is due. nextEventAt() tells when that is, so the application
+ * can sleep instead of calling update() in a busy loop:
+ *
+ *   sampler.update(&sample);
+ *   sleepFor(sampler.timeToNextEvent());   // board specific light sleep
+ *
+ * Scratchpads the driver flags as invalid (85 °C power-on value, all 0xFF,
+ * all 0x00, CRC error) do not fail the sweep: the engine reconverts just that
+ * sensor up to setMaxRetries() times before moving on. A power-on value that
+ * survives a fresh conversion is accepted as a genuine 85.00 °C reading.
+ */
+
+#ifndef DS2482_SAMPLER_H
+#define DS2482_SAMPLER_H
+
+#include "DS2482.h"
+
+// One temperature sample produced by the sampling engine
+struct DS2482Sample {
+    uint8_t channel;            // Channel the sensor is connected to
+    int16_t raw;                // Temperature in 1/16 °C as read from the sensor
+    int16_t value;              // Temperature in 1/16 °C after filtering
+    unsigned long timestamp;    // millis() when the sample was read
+    uint32_t startMicros;       // micros() when Convert T was issued - the sampling instant
+    uint32_t finishMicros;      // micros() when the conversion was seen complete
+
+    float celsius() const { return value / 16.0; }
+    uint32_t conversionMicros() const { return finishMicros - startMicros; }
+    uint32_t microsSince(const DS2482Sample& earlier) const { return startMicros - earlier.startMicros; }  // Wrap-safe below 71 minutes
+};
+
+// Fixed-point filter chain for one sensor: reject -> median -> rate limit -> EMA
+struct DS2482Filter {
+    // Configuration
+    bool rejectInvalid;         // Drop 85.00 °C power-on and -127.00 °C readings
+    uint8_t medianTaps;         // 0 (off), 3 or 5
+    uint8_t emaShift;           // 0 (off) or alpha = 1 / 2^emaShift
+    int16_t maxStep;            // Largest change per sample in 1/16 °C, 0 = unlimited
+
+    // State
+    int16_t window[5];          // Median history
+    uint8_t windowCount;
+    uint8_t windowIndex;
+    bool primed;                // Rate limiter and EMA have a previous value
+    int16_t last;               // Previous rate limited value
+    int32_t emaQ8;              // EMA state, 8 fractional bits
+    uint16_t rejected;          // Samples dropped as invalid
+
+    void configure(bool rejectInvalid, uint8_t medianTaps, uint8_t emaShift, int16_t maxStep);
+    void clear();
+    bool apply(int16_t raw, int16_t* value);  // false if the sample was rejected
+};
+
+// Report-on-change policy and state for one sensor
+struct DS2482Report {
+    // Configuration
+    int16_t deadband;           // Minimum change to report, in 1/16 °C (0 = report every sample)
+    unsigned long heartbeat;    // Report anyway after this many ms of silence (0 = never)
+
+    // State
+    bool reported;              // A value has been reported
+    int16_t lastValue;          // Last reported value in 1/16 °C
+    unsigned long lastTime;     // millis() of the last report
+    uint16_t suppressed;        // Samples withheld since the last report
+
+    void configure(int16_t deadband, unsigned long heartbeat);
+    void clear();
+    bool check(int16_t value, unsigned long now);  // true if the sample should be reported
+};
+
+// Running statistics of one sensor, updated with every sample
+struct DS2482SensorStats {
+    uint32_t count;             // Number of samples
+    int16_t minRaw;             // Lowest temperature in 1/16 °C
+    int16_t maxRaw;             // Highest temperature in 1/16 °C
+    int32_t meanQ8;             // Mean in 1/16 °C, 8 fractional bits
+    int64_t m2Q16;              // Sum of squared deviations in (1/16 °C)^2, 16 fractional bits
+    unsigned long lastUpdate;   // millis() of the last sample
+
+    void add(int16_t raw, unsigned long timestamp);
+    void clear();
+    float meanCelsius() const { return meanQ8 / 4096.0; }
+    float varianceCelsius() const;  // Sample variance in °C^2
+};
+
+class DS2482Sampler {
+public:
+    DS2482Sampler(DS2482& bridge);
+
+    // Configuration
+    void setChannels(uint8_t mask) { channelMask = mask; }  // Bit n enables channel n
+    uint8_t getChannels() { return channelMask; }
+    void setInterval(unsigned long ms) { interval = ms; }   // Minimum time between sweep starts
+    void setMaxRetries(uint8_t retries) { maxRetries = retries; }  // Reconverts after an invalid frame
+
+    // Operation
+    bool update(DS2482Sample* sample);  // Advance one step, true when a sample is returned
+    uint8_t getErrorCount(uint8_t channel) { return channel < 8 ? errors[channel] : 0; }
+    uint16_t getRetryCount() { return retryCount; }  // Reconverts scheduled so far
+    uint16_t getFailureStreak() { return failureStreak; }  // Failed channels since the last good read
+    void resetFailureStreak() { failureStreak = 0; }       // E.g. after recover()
+    unsigned long nextEventAt();        // millis() when update() has work next
+    unsigned long timeToNextEvent();    // ms until then, 0 if update() has work now
+
+    // Filtering
+    void attachFilters(DS2482Filter* filters);   // Array of 8, or nullptr to disable
+    DS2482Filter* getFilter(uint8_t channel);
+
+    // Change-only reporting
+    void attachReports(DS2482Report* reports);   // Array of 8, or nullptr to report every sample
+    DS2482Report* getReport(uint8_t channel);
+
+    // Statistics
+    void attachStats(DS2482SensorStats* stats);  // Array of 8, or nullptr to disable
+    const DS2482SensorStats* getStats(uint8_t channel);
+    void resetStats();
+
+private:
+    DS2482& bridge;
+    uint8_t channelMask;
+    unsigned long interval;
+    unsigned long sweepStart;   // millis() when the current sweep began
+    uint8_t channel;            // Channel being sampled
+    bool converting;            // Conversion started on channel
+    bool swept;                 // At least one sweep has been started
+    uint8_t maxRetries;
+    uint8_t retries;            // Reconverts of the current channel
+    uint16_t retryCount;
+    uint16_t failureStreak;
+    uint8_t errors[8];
+    DS2482SensorStats* stats;
+    DS2482Filter* filters;
+    DS2482Report* reports;
+
+    bool nextChannel();
+    void channelFailed();
+};
+
+#endif
@@ -0,0 +1,661 @@
+/**
+ * APADevices - DS2482Scenario.cpp - Text descriptions of simulated deployments
+ *
+ * The reader collects one line at a time in a fixed buffer, splits it into
+ * tokens in place and writes the result straight into the target scenario.
+ * Nothing is allocated and no state is kept beyond the current line, so the
+ * input can be arbitrarily long.
+ */
+
+#include "DS2482Scenario.h"
+
+#define SCENARIO_DEFAULT_I2C_HZ   100000
+#define SCENARIO_DEFAULT_RAW      (20 * 16)     // 20 °C when no temperature is given
+#define SCENARIO_MIN_RAW          (-55 * 16)    // DS18B20 measuring range
+#define SCENARIO_MAX_RAW          (125 * 16)
+#define SCENARIO_MAX_SECONDS      4294967UL     // Longest time that fits in ms
+
+// sin() of the first quarter wave in 16 steps, Q15
+static const uint16_t quarterSine[17] = {
+    0, 3212, 6393, 9512, 12539, 15446, 18204, 20787, 23170,
+    25329, 27245, 28898, 30273, 31356, 32137, 32609, 32767
+};
+
+// Fault names in DS2482Fault order
+static const char* const faultNames[DS2482_FAULT_COUNT] = {"nack", "corrupt", "hold", "presence", "stuck"};
+
+/**
+ * Sine of a phase, by interpolation in the quarter wave table
+ * @param phase Full cycle in 65536 steps
+ * @return Sine in Q15
+ */
+static int32_t sine(uint16_t phase) {
+    uint16_t within = phase & 0x3FFF;
+    uint8_t quadrant = phase >> 14;
+    if (quadrant & 1) {
+        within = 0x4000 - within;
+    }
+    uint8_t index = within >> 10;
+    int32_t value = quarterSine[index];
+    if (index < 16) {
+        value += ((int32_t)(quarterSine[index + 1] - quarterSine[index]) * (within & 0x3FF)) >> 10;
+    }
+    return (quadrant & 2) ? -value : value;
+}
+
+/**
+ * Compare two strings ignoring ASCII case
+ */
+static bool sameWord(const char* a, const char* b) {
+    while (*a && *b) {
+        char x = (*a >= 'A' && *a <= 'Z') ? *a + 32 : *a;
+        char y = (*b >= 'A' && *b <= 'Z') ? *b + 32 : *b;
+        if (x != y) {
+            return false;
+        }
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/**
+ * Value of a hex digit
+ * @return 0-15, or -1 if c is not a hex digit
+ */
+static int8_t hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Parse an unsigned decimal or 0x-prefixed hex number
+ * @param text Token, must be consumed completely
+ * @param value Receives the number
+ * @return false on anything but digits, or on overflow
+ */
+static bool parseNumber(const char* text, uint32_t* value) {
+    uint8_t base = 10;
+    if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        base = 16;
+        text += 2;
+    }
+    if (!*text) {
+        return false;
+    }
+    uint32_t result = 0;
+    for (; *text; text++) {
+        int8_t digit = hexDigit(*text);
+        if (digit < 0 || digit >= base || result > (0xFFFFFFFFUL - digit) / base) {
+            return false;
+        }
+        result = result * base + digit;
+    }
+    *value = result;
+    return true;
+}
+
+/**
+ * Parse a temperature in °C with up to four decimals
+ * @param text Token such as "21.5" or "-10.0625"
+ * @param raw Receives the temperature in 1/16 °C, rounded
+ * @return false if malformed or outside -55 to 125 °C
+ */
+static bool parseTemperature(const char* text, int16_t* raw) {
+    bool negative = (*text == '-');
+    if (negative || *text == '+') {
+        text++;
+    }
+    int32_t whole = 0;
+    uint16_t fraction = 0;
+    uint16_t scale = 1;
+    bool digits = false;
+    for (; *text >= '0' && *text <= '9'; text++) {
+        whole = whole * 10 + (*text - '0');
+        digits = true;
+        if (whole > 1000) {
+            return false;
+        }
+    }
+    if (*text == '.') {
+        for (text++; *text >= '0' && *text <= '9'; text++) {
+            if (scale == 10000) {
+                return false;
+            }
+            fraction = fraction * 10 + (*text - '0');
+            scale *= 10;
+            digits = true;
+        }
+    }
+    if (*text || !digits) {
+        return false;
+    }
+    int32_t value = whole * 16 + ((int32_t)fraction * 16 + scale / 2) / scale;
+    if (negative) {
+        value = -value;
+    }
+    if (value < SCENARIO_MIN_RAW || value > SCENARIO_MAX_RAW) {
+        return false;
+    }
+    *raw = value;
+    return true;
+}
+
+/**
+ * Parse a duration in whole seconds
+ * @param ms Receives milliseconds
+ */
+static bool parseSeconds(const char* text, uint32_t* ms) {
+    uint32_t seconds;
+    if (!parseNumber(text, &seconds) || seconds > SCENARIO_MAX_SECONDS) {
+        return false;
+    }
+    *ms = seconds * 1000;
+    return true;
+}
+
+/**
+ * Parse a ROM code of 7 bytes, or 8 with a matching CRC, in hex separated by - or :
+ * @param rom Receives family code and serial
+ */
+static bool parseRom(const char* text, uint8_t* rom) {
+    uint8_t bytes[8];
+    uint8_t count = 0;
+    while (*text) {
+        int8_t high = hexDigit(text[0]);
+        int8_t low = high < 0 ? -1 : hexDigit(text[1]);
+        if (low < 0 || count == 8) {
+            return false;
+        }
+        bytes[count++] = (high << 4) | low;
+        text += 2;
+        if (*text == '-' || *text == ':') {
+            text++;
+            if (!*text) {
+                return false;
+            }
+        } else if (*text) {
+            return false;
+        }
+    }
+    if (count < 7 || (count == 8 && DS2482::crc8(bytes, 7) != bytes[7])) {
+        return false;
+    }
+    for (uint8_t i = 0; i < 7; i++) {
+        rom[i] = bytes[i];
+    }
+    return true;
+}
+
+/**
+ * Raw temperature of the sensor at a point in the run
+ * @param ms Milliseconds since the start of the run
+ * @return Temperature in 1/16 °C
+ */
+int16_t DS2482ScenarioSensor::temperatureAt(uint32_t ms) const {
+    if (wave == DS2482Wave::CONSTANT || !periodMs) {
+        return low;
+    }
+    uint32_t t = ms % periodMs;
+    int32_t span = (int32_t)high - low;
+    switch (wave) {
+        case DS2482Wave::RAMP:
+            return low + (int16_t)((int64_t)span * t / periodMs);
+        case DS2482Wave::SQUARE:
+            return t < periodMs / 2 ? low : high;
+        case DS2482Wave::SINE: {
+            uint16_t phase = (uint64_t)t * 65536 / periodMs;
+            return low + span / 2 + (int16_t)((span / 2) * sine(phase) / 32767);
+        }
+        default:
+            return low;
+    }
+}
+
+/**
+ * Channels with a sensor
+ * @return Bit n set if channel n has a sensor
+ */
+uint8_t DS2482ScenarioBridge::getChannels() const {
+    uint8_t mask = 0;
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        if (sensors[channel].present) {
+            mask |= 1 << channel;
+        }
+    }
+    return mask;
+}
+
+/**
+ * Empty scenario with the defaults
+ */
+void DS2482Scenario::clear() {
+    name[0] = '\0';
+    i2cClock = SCENARIO_DEFAULT_I2C_HZ;
+    durationMs = 0;
+    seed = 1;
+    bridgeCount = 0;
+    faultCount = 0;
+    for (uint8_t b = 0; b < DS2482_SCENARIO_MAX_BRIDGES; b++) {
+        bridges[b].address = 0;
+        for (uint8_t channel = 0; channel < 8; channel++) {
+            bridges[b].sensors[channel].present = false;
+        }
+    }
+}
+
+/**
+ * Populate a simulated bridge
+ * Sensors start at their temperature at time 0. Without an explicit ROM a
+ * sensor keeps the simulator's ROM with the scenario's family code.
+ * @param bridge Index of the bridge in the scenario
+ * @param sim Simulator to set up; its address should match the bridge's
+ */
+void DS2482Scenario::apply(uint8_t bridge, DS2482Sim& sim) const {
+    if (bridge >= bridgeCount) {
+        return;
+    }
+    const DS2482ScenarioBridge& entry = bridges[bridge];
+    sim.setI2CClock(i2cClock);
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        const DS2482ScenarioSensor& sensor = entry.sensors[channel];
+        if (!sensor.present) {
+            sim.detachSensor(channel);
+            continue;
+        }
+        sim.attachSensor(channel, sensor.temperatureAt(0), sensor.resolution);
+        if (sensor.romSet) {
+            sim.setRom(channel, sensor.rom);
+        } else if (sensor.family != DS2482_FAMILY_DS18B20) {
+            const uint8_t rom[7] = {sensor.family, channel, entry.address, 'P', 'A', 0x00, 0x00};
+            sim.setRom(channel, rom);
+        }
+    }
+}
+
+/**
+ * Move the simulated temperatures along their waveforms
+ * @param bridge Index of the bridge in the scenario
+ * @param sim Simulator set up with apply()
+ * @param ms Milliseconds since the start of the run
+ */
+void DS2482Scenario::update(uint8_t bridge, DS2482Sim& sim, uint32_t ms) const {
+    if (bridge >= bridgeCount) {
+        return;
+    }
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        const DS2482ScenarioSensor& sensor = bridges[bridge].sensors[channel];
+        if (sensor.present && sensor.wave != DS2482Wave::CONSTANT) {
+            sim.setTemperature(channel, sensor.temperatureAt(ms));
+        }
+    }
+}
+
+/**
+ * Set the fault rates in effect for a bridge
+ * Where windows of the same fault overlap, the entry given last wins.
+ * @param bridge Index of the bridge in the scenario
+ * @param faults Fault injector in front of the bridge's simulator
+ * @param ms Milliseconds since the start of the run
+ */
+void DS2482Scenario::applyFaults(uint8_t bridge, DS2482FaultBus& faults, uint32_t ms) const {
+    uint16_t rates[DS2482_FAULT_COUNT] = {0};
+    for (uint8_t i = 0; i < faultCount; i++) {
+        if (this->faults[i].bridge == bridge && this->faults[i].activeAt(ms)) {
+            rates[(uint8_t)this->faults[i].fault] = this->faults[i].rate;
+        }
+    }
+    for (uint8_t i = 0; i < DS2482_FAULT_COUNT; i++) {
+        faults.setRate((DS2482Fault)i, rates[i]);
+    }
+}
+
+/**
+ * Describe a bridge's sensor population to the cost model
+ * The conversion time is set to that of the slowest sensor, the wait a
+ * driver sampling the bridge needs. A scenario without I2C timing leaves
+ * the model's clock as it is.
+ * @param bridge Index of the bridge in the scenario
+ * @param model Cost model to set up
+ */
+void DS2482Scenario::applyModel(uint8_t bridge, DS2482CostModel& model) const {
+    if (bridge >= bridgeCount) {
+        return;
+    }
+    if (i2cClock) {
+        model.setI2CClock(i2cClock);
+    }
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        const DS2482ScenarioSensor& sensor = bridges[bridge].sensors[channel];
+        if (sensor.present) {
+            model.setSensor(channel, sensor.family, sensor.resolution);
+        } else {
+            model.removeSensor(channel);
+        }
+    }
+    model.setConversionTime(model.slowestConversionTime());
+}
+
+/**
+ * Constructor
+ * @param scenario Caller-owned target every parsed scenario is written to
+ */
+DS2482ScenarioReader::DS2482ScenarioReader(DS2482Scenario& scenario) : scenario(scenario) {
+    reset();
+}
+
+/**
+ * Forget any partial input and start again at line 1
+ */
+void DS2482ScenarioReader::reset() {
+    length = 0;
+    overflow = false;
+    lineNumber = 0;
+    error = nullptr;
+    errorLine = 0;
+    inScenario = false;
+    skipping = false;
+    scenario.clear();
+}
+
+/**
+ * Take the next character of the scenario text
+ * @param c Character; '\r' is ignored, '\n' ends a line
+ * @return READY when "end" completed a scenario, ERROR when a line was rejected
+ */
+DS2482ScenarioStatus DS2482ScenarioReader::feed(char c) {
+    if (c == '\n') {
+        return endLine();
+    }
+    if (c == '\r') {
+        return DS2482ScenarioStatus::MORE;
+    }
+    if (length < DS2482_SCENARIO_LINE_MAX) {
+        line[length++] = c;
+    } else {
+        overflow = true;
+    }
+    return DS2482ScenarioStatus::MORE;
+}
+
+/**
+ * End of the input
+ * @return Result of a last line without newline, or ERROR if a scenario has no "end"
+ */
+DS2482ScenarioStatus DS2482ScenarioReader::finish() {
+    if (length || overflow) {
+        DS2482ScenarioStatus status = endLine();
+        if (status != DS2482ScenarioStatus::MORE) {
+            return status;
+        }
+    }
+    if (inScenario && !skipping) {
+        inScenario = false;
+        return fail("scenario without end");
+    }
+    inScenario = false;
+    skipping = false;
+    return DS2482ScenarioStatus::MORE;
+}
+
+/**
+ * Split the completed line into tokens and parse it
+ */
+DS2482ScenarioStatus DS2482ScenarioReader::endLine() {
+    lineNumber++;
+    line[length] = '\0';
+    bool tooLong = overflow;
+    length = 0;
+    overflow = false;
+
+    char* tokens[DS2482_SCENARIO_MAX_TOKENS];
+    uint8_t count = 0;
+    for (char* p = line; *p && *p != '#';) {
+        if (*p == ' ' || *p == '\t') {
+            *p++ = '\0';
+            continue;
+        }
+        if (count == DS2482_SCENARIO_MAX_TOKENS) {
+            tooLong = true;
+            break;
+        }
+        tokens[count++] = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '#') {
+            p++;
+        }
+        if (*p == '#') {
+            *p = '\0';
+        }
+    }
+
+    if (skipping) {
+        // Only the end of the broken scenario or the start of another one matters
+        if (count && sameWord(tokens[0], "end")) {
+            skipping = false;
+            inScenario = false;
+            return DS2482ScenarioStatus::MORE;
+        }
+        if (!count || !sameWord(tokens[0], "scenario")) {
+            return DS2482ScenarioStatus::MORE;
+        }
+        skipping = false;
+        inScenario = false;
+    }
+    if (tooLong) {
+        return fail("line too long");
+    }
+    if (!count) {
+        return DS2482ScenarioStatus::MORE;
+    }
+    return parseLine(tokens, count);
+}
+
+/**
+ * Apply one line of keyword and arguments to the scenario
+ */
+DS2482ScenarioStatus DS2482ScenarioReader::parseLine(char** tokens, uint8_t count) {
+    const char* keyword = tokens[0];
+
+    if (sameWord(keyword, "scenario")) {
+        bool unfinished = inScenario;
+        scenario.clear();
+        inScenario = true;
+        if (count > 1) {
+            uint8_t i = 0;
+            for (; tokens[1][i] && i < DS2482_SCENARIO_NAME_MAX - 1; i++) {
+                scenario.name[i] = tokens[1][i];
+            }
+            scenario.name[i] = '\0';
+        }
+        if (unfinished) {
+            // Report the missing end, but carry on with the new scenario
+            error = "previous scenario without end";
+            errorLine = lineNumber;
+            return DS2482ScenarioStatus::ERROR;
+        }
+        return DS2482ScenarioStatus::MORE;
+    }
+    if (!inScenario) {
+        return fail("expected scenario");
+    }
+
+    if (sameWord(keyword, "end")) {
+        if (!scenario.bridgeCount) {
+            return fail("scenario without bridge");
+        }
+        inScenario = false;
+        return DS2482ScenarioStatus::READY;
+    }
+    if (sameWord(keyword, "sensor")) {
+        return parseSensor(tokens, count);
+    }
+    if (sameWord(keyword, "fault")) {
+        return parseFault(tokens, count);
+    }
+
+    uint32_t value;
+    if (count != 2 || !parseNumber(tokens[1], &value)) {
+        return fail("expected keyword and one number");
+    }
+    if (sameWord(keyword, "i2c")) {
+        scenario.i2cClock = value;
+    } else if (sameWord(keyword, "seed")) {
+        scenario.seed = value;
+    } else if (sameWord(keyword, "duration")) {
+        if (!parseSeconds(tokens[1], &scenario.durationMs)) {
+            return fail("duration too long");
+        }
+    } else if (sameWord(keyword, "bridge")) {
+        if (value < 0x18 || value > 0x1B) {
+            return fail("bridge address must be 0x18-0x1B");
+        }
+        if (scenario.bridgeCount == DS2482_SCENARIO_MAX_BRIDGES) {
+            return fail("too many bridges");
+        }
+        for (uint8_t b = 0; b < scenario.bridgeCount; b++) {
+            if (scenario.bridges[b].address == value) {
+                return fail("bridge address used twice");
+            }
+        }
+        scenario.bridges[scenario.bridgeCount++].address = value;
+    } else {
+        return fail("unknown keyword");
+    }
+    return DS2482ScenarioStatus::MORE;
+}
+
+/**
+ * sensor <channel> <family> [resolution] [rom <code>] [temp <t> | ramp|sine|square <low> <high> <seconds>]
+ */
+DS2482ScenarioStatus DS2482ScenarioReader::parseSensor(char** tokens, uint8_t count) {
+    if (!scenario.bridgeCount) {
+        return fail("sensor before bridge");
+    }
+    uint32_t channel;
+    if (count < 3 || !parseNumber(tokens[1], &channel) || channel > 7) {
+        return fail("expected channel 0-7 and family");
+    }
+    DS2482ScenarioSensor& sensor = scenario.bridges[scenario.bridgeCount - 1].sensors[channel];
+    if (sensor.present) {
+        return fail("channel already has a sensor");
+    }
+
+    uint32_t family;
+    if (sameWord(tokens[2], "DS18B20")) {
+        family = DS2482_FAMILY_DS18B20;
+    } else if (sameWord(tokens[2], "DS1822")) {
+        family = DS2482_FAMILY_DS1822;
+    } else if (sameWord(tokens[2], "DS18S20")) {
+        family = DS2482_FAMILY_DS18S20;
+    } else if (!parseNumber(tokens[2], &family)) {
+        return fail("unknown sensor family");
+    }
+    if (family != DS2482_FAMILY_DS18B20 && family != DS2482_FAMILY_DS1822) {
+        return fail("family not simulated");   // DS18S20 has another scratchpad format
+    }
+
+    sensor.family = family;
+    sensor.resolution = 12;
+    sensor.romSet = false;
+    sensor.wave = DS2482Wave::CONSTANT;
+    sensor.low = SCENARIO_DEFAULT_RAW;
+    sensor.high = SCENARIO_DEFAULT_RAW;
+    sensor.periodMs = 0;
+
+    uint8_t i = 3;
+    uint32_t resolution;
+    if (i < count && parseNumber(tokens[i], &resolution)) {
+        if (resolution < 9 || resolution > 12) {
+            return fail("resolution must be 9-12");
+        }
+        sensor.resolution = resolution;
+        i++;
+    }
+
+    while (i < count) {
+        const char* option = tokens[i++];
+        if (sameWord(option, "rom")) {
+            if (i == count || !parseRom(tokens[i++], sensor.rom)) {
+                return fail("expected 7 ROM bytes, or 8 with CRC");
+            }
+            if (sensor.rom[0] != family) {
+                return fail("ROM family does not match");
+            }
+            sensor.romSet = true;
+        } else if (sameWord(option, "temp")) {
+            if (i == count || !parseTemperature(tokens[i++], &sensor.low)) {
+                return fail("expected temperature -55 to 125");
+            }
+            sensor.high = sensor.low;
+        } else if (sameWord(option, "ramp") || sameWord(option, "sine") || sameWord(option, "square")) {
+            sensor.wave = sameWord(option, "ramp") ? DS2482Wave::RAMP :
+                          sameWord(option, "sine") ? DS2482Wave::SINE : DS2482Wave::SQUARE;
+            if (i + 3 > count ||
+                !parseTemperature(tokens[i], &sensor.low) ||
+                !parseTemperature(tokens[i + 1], &sensor.high) ||
+                !parseSeconds(tokens[i + 2], &sensor.periodMs) || !sensor.periodMs) {
+                return fail("expected low, high and period in seconds");
+            }
+            i += 3;
+        } else {
+            return fail("unknown sensor option");
+        }
+    }
+
+    sensor.present = true;
+    return DS2482ScenarioStatus::MORE;
+}
+
+/**
+ * fault <nack|corrupt|hold|presence|stuck> <rate> [from <seconds>] [until <seconds>]
+ */
+DS2482ScenarioStatus DS2482ScenarioReader::parseFault(char** tokens, uint8_t count) {
+    if (!scenario.bridgeCount) {
+        return fail("fault before bridge");
+    }
+    if (scenario.faultCount == DS2482_SCENARIO_MAX_FAULTS) {
+        return fail("too many faults");
+    }
+    uint8_t kind = 0;
+    while (kind < DS2482_FAULT_COUNT && (count < 2 || !sameWord(tokens[1], faultNames[kind]))) {
+        kind++;
+    }
+    if (kind == DS2482_FAULT_COUNT) {
+        return fail("unknown fault");
+    }
+    uint32_t rate;
+    if (count < 3 || !parseNumber(tokens[2], &rate) || rate > DS2482_FAULT_RATE_SCALE) {
+        return fail("expected rate 0-10000");
+    }
+
+    DS2482ScenarioFault& fault = scenario.faults[scenario.faultCount];
+    fault.bridge = scenario.bridgeCount - 1;
+    fault.fault = (DS2482Fault)kind;
+    fault.rate = rate;
+    fault.fromMs = 0;
+    fault.untilMs = 0;
+    for (uint8_t i = 3; i < count; i += 2) {
+        uint32_t* target = sameWord(tokens[i], "from") ? &fault.fromMs :
+                           sameWord(tokens[i], "until") ? &fault.untilMs : nullptr;
+        if (!target || i + 1 == count || !parseSeconds(tokens[i + 1], target)) {
+            return fail("expected from or until and seconds");
+        }
+    }
+    if (fault.untilMs && fault.untilMs <= fault.fromMs) {
+        return fail("fault window ends before it starts");
+    }
+    scenario.faultCount++;
+    return DS2482ScenarioStatus::MORE;
+}
+
+/**
+ * Reject the current line and skip the rest of its scenario
+ */
+DS2482ScenarioStatus DS2482ScenarioReader::fail(const char* message) {
+    error = message;
+    errorLine = lineNumber;
+    skipping = inScenario;
+    return DS2482ScenarioStatus::ERROR;
+}
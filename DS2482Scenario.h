@@ -0,0 +1,157 @@
+/**
+ * APADevices - DS2482Scenario.h - Text descriptions of simulated deployments
+ *
+ * A scenario describes a deployment for the simulator: the bridges and their
+ * addresses, the sensor on each channel with family, ROM and resolution, how
+ * its temperature changes over time, and when which faults are injected.
+ * DS2482ScenarioReader parses them from text one character at a time into a
+ * caller-owned DS2482Scenario, with no heap and a single line of buffer, so
+ * scenarios can stream in from Serial, a file or a string in flash:
+ *
+ *   # Two bridges on a 400 kHz bus
+ *   scenario greenhouse
+ *   i2c 400000
+ *   duration 600                       # Seconds the caller should run it
+ *   seed 7                             # Fault schedule seed
+ *   bridge 0x18
+ *   sensor 0 DS18B20 12 temp 21.5
+ *   sensor 1 DS1822 9 rom 22-01-02-03-04-05-06 sine 15 25 600
+ *   fault corrupt 50                   # Per 10000, for the whole run
+ *   bridge 0x19
+ *   sensor 3 DS18B20 10 ramp 10 30 3600
+ *   fault stuck 1 from 120 until 180   # Seconds since the start
+ *   end
+ *
+ * Temperatures are in °C with up to four decimals. Waveforms take a low and
+ * a high value and a period in seconds: ramp (sawtooth from low to high),
+ * sine (starting halfway up) and square (low for the first half). Faults
+ * are nack, corrupt, hold, presence and stuck, at a rate per 10000 as in
+ * DS2482FaultBus, and apply to the bridge declared last. Text after '#' is a
+ * comment.
+ *
+ * Several scenarios may follow each other; feed() returns READY after each
+ * "end". A scenario with an error is skipped up to its "end" and reported
+ * with its line number.
+ *
+ *   DS2482Scenario scenario;
+ *   DS2482ScenarioReader reader(scenario);
+ *   while (Serial.available()) {
+ *       if (reader.feed(Serial.read()) == DS2482ScenarioStatus::READY) {
+ *           run(scenario);
+ *       }
+ *   }
+ */
+
+#ifndef DS2482_SCENARIO_H
+#define DS2482_SCENARIO_H
+
+#include "DS2482.h"
+#include "DS2482Sim.h"
+#include "DS2482FaultBus.h"
+#include "DS2482CostModel.h"
+
+#define DS2482_SCENARIO_MAX_BRIDGES  4     // DS2482-800 address pins allow 0x18-0x1B
+#define DS2482_SCENARIO_MAX_FAULTS   8     // Fault schedule entries per scenario
+#define DS2482_SCENARIO_LINE_MAX     96    // Longest line, comment included
+#define DS2482_SCENARIO_NAME_MAX     24    // Scenario name, terminator included
+#define DS2482_SCENARIO_MAX_TOKENS   12
+
+// Temperature course of a simulated sensor
+enum class DS2482Wave : uint8_t {
+    CONSTANT,           // Always low
+    RAMP,               // Sawtooth from low to high
+    SINE,               // Between low and high, starting halfway up
+    SQUARE              // Low for the first half of the period, then high
+};
+
+// Result of feeding the reader
+enum class DS2482ScenarioStatus : uint8_t {
+    MORE,               // Keep feeding
+    READY,              // A complete scenario is in the target
+    ERROR               // The current line is invalid; see getError()
+};
+
+// Sensor on one channel
+struct DS2482ScenarioSensor {
+    bool present;
+    uint8_t family;             // DS2482_FAMILY_*
+    uint8_t resolution;         // 9-12 bits
+    bool romSet;                // rom holds an explicit ROM code
+    uint8_t rom[7];             // Family code and serial; the simulator adds the CRC
+    DS2482Wave wave;
+    int16_t low;                // 1/16 °C
+    int16_t high;
+    uint32_t periodMs;
+
+    int16_t temperatureAt(uint32_t ms) const;  // Raw temperature ms into the run
+};
+
+// Bridge and its channels
+struct DS2482ScenarioBridge {
+    uint8_t address;
+    DS2482ScenarioSensor sensors[8];
+
+    uint8_t getChannels() const;    // Bit n set if channel n has a sensor
+};
+
+// Fault rate applied to one bridge during a time window
+struct DS2482ScenarioFault {
+    uint8_t bridge;             // Index into DS2482Scenario::bridges
+    DS2482Fault fault;
+    uint16_t rate;              // Per DS2482_FAULT_RATE_SCALE
+    uint32_t fromMs;
+    uint32_t untilMs;           // 0 = until the end
+
+    bool activeAt(uint32_t ms) const { return ms >= fromMs && (!untilMs || ms < untilMs); }
+};
+
+struct DS2482Scenario {
+    char name[DS2482_SCENARIO_NAME_MAX];
+    uint32_t i2cClock;          // Hz, 100000 unless given; 0 = transactions take no time
+    uint32_t durationMs;        // 0 = not given
+    uint32_t seed;              // Fault schedule seed
+    uint8_t bridgeCount;
+    DS2482ScenarioBridge bridges[DS2482_SCENARIO_MAX_BRIDGES];
+    uint8_t faultCount;
+    DS2482ScenarioFault faults[DS2482_SCENARIO_MAX_FAULTS];
+
+    void clear();
+
+    // Setting up simulated hardware for a bridge, by index
+    void apply(uint8_t bridge, DS2482Sim& sim) const;                         // Sensors, ROMs, I2C clock, initial temperatures
+    void update(uint8_t bridge, DS2482Sim& sim, uint32_t ms) const;           // Temperatures ms into the run
+    void applyFaults(uint8_t bridge, DS2482FaultBus& faults, uint32_t ms) const;  // Rates in effect ms into the run
+    void applyModel(uint8_t bridge, DS2482CostModel& model) const;            // Same topology in the cost model
+};
+
+class DS2482ScenarioReader {
+public:
+    DS2482ScenarioReader(DS2482Scenario& scenario);
+
+    DS2482ScenarioStatus feed(char c);          // Next character of the text
+    DS2482ScenarioStatus finish();              // End of input, for text without a final newline
+    void reset();                               // Start over at line 1
+
+    const char* getError() { return error; }    // Message of the last ERROR, nullptr if none
+    uint16_t getErrorLine() { return errorLine; }
+    uint16_t getLineNumber() { return lineNumber; }
+
+private:
+    DS2482Scenario& scenario;
+    char line[DS2482_SCENARIO_LINE_MAX + 1];
+    uint8_t length;
+    bool overflow;              // Current line is longer than the buffer
+    uint16_t lineNumber;
+    const char* error;
+    uint16_t errorLine;
+    bool inScenario;
+    bool skipping;              // Error seen, ignoring lines up to "end"
+
+    DS2482ScenarioStatus endLine();
+    DS2482ScenarioStatus parseLine(char** tokens, uint8_t count);
+    DS2482ScenarioStatus parseSensor(char** tokens, uint8_t count);
+    DS2482ScenarioStatus parseFault(char** tokens, uint8_t count);
+    DS2482ScenarioStatus fail(const char* message);
+};
+
+#endif
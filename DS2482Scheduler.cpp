@@ -0,0 +1,235 @@
+/**
+ * APADevices - DS2482Scheduler.cpp - Priority / deadline scheduling of DS2482 channels
+ *
+ * A job is the start of a conversion followed by the read of its result.
+ * Both steps are separate update() calls, so a more urgent job can run
+ * between them; the sensor keeps converting in the meantime.
+ */
+
+#include "DS2482Scheduler.h"
+
+/**
+ * Constructor
+ * @param bridge Initialized DS2482 the sensors are connected to
+ */
+DS2482Scheduler::DS2482Scheduler(DS2482& bridge) :
+    bridge(bridge) {
+    for (uint8_t i = 0; i < 8; i++) {
+        tasks[i].period = 0;
+        tasks[i].converting = false;
+        errors[i] = 0;
+    }
+    resetCounters();
+}
+
+/**
+ * Schedule a sensor; its first job is released immediately
+ * @param channel Channel number (0-7)
+ * @param priority Priority class, DS2482_PRIORITY_HIGHEST (0) is served first
+ * @param period Time between samples in ms
+ * @param deadline Time after each release by which the sample must be read, 0 = period
+ */
+void DS2482Scheduler::setSensor(uint8_t channel, uint8_t priority, unsigned long period, unsigned long deadline) {
+    if (channel > 7) {
+        return;
+    }
+    DS2482Task& task = tasks[channel];
+    task.priority = priority;
+    task.period = period;
+    task.deadline = deadline ? deadline : period;
+    task.release = bridge.getClock().millis();
+    task.converting = false;
+}
+
+/**
+ * Stop scheduling a sensor
+ * @param channel Channel number (0-7)
+ */
+void DS2482Scheduler::removeSensor(uint8_t channel) {
+    if (channel > 7) {
+        return;
+    }
+    tasks[channel].period = 0;
+    tasks[channel].converting = false;
+}
+
+/**
+ * Clear job, deadline miss and error counters of all sensors
+ */
+void DS2482Scheduler::resetCounters() {
+    for (uint8_t i = 0; i < 8; i++) {
+        tasks[i].completed = 0;
+        tasks[i].misses = 0;
+        tasks[i].maxLateness = 0;
+        errors[i] = 0;
+    }
+}
+
+/**
+ * Run the most urgent operation that is ready
+ * A start is ready once its job is released, a read once the conversion
+ * time has passed. The lowest class number wins, then the earliest
+ * absolute deadline. Call this from loop() as often as possible.
+ * @param sample Receives the sample when a read completes
+ * @return true if a new sample was written to sample
+ */
+bool DS2482Scheduler::update(DS2482Sample* sample) {
+    unsigned long now = bridge.getClock().millis();
+
+    uint8_t best = 0xFF;
+    unsigned long bestDeadline = 0;
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        const DS2482Task& task = tasks[channel];
+        if (!task.period) {
+            continue;
+        }
+        if ((long)(now - readyAt(channel)) < 0) {
+            continue;
+        }
+
+        unsigned long deadline = task.release + task.deadline;
+        if (best == 0xFF ||
+            task.priority < tasks[best].priority ||
+            (task.priority == tasks[best].priority && (long)(deadline - bestDeadline) < 0)) {
+            best = channel;
+            bestDeadline = deadline;
+        }
+    }
+
+    if (best == 0xFF) {
+        return false;
+    }
+
+    // A Convert T still shifting out on another channel is waited for by
+    // selectChannel(), and only while the driver has one pending
+
+    if (tasks[best].converting) {
+        return readSample(best, now, sample);
+    }
+    startConversion(best, now);
+    return false;
+}
+
+/**
+ * Earliest time any operation is ready
+ * @return millis() of the next release or conversion completion, possibly
+ *         already past; DS2482_NEVER_MS from now if no sensor is scheduled
+ */
+unsigned long DS2482Scheduler::nextEventAt() {
+    unsigned long now = bridge.getClock().millis();
+    unsigned long next = now + DS2482_NEVER_MS;
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        if (!tasks[channel].period) {
+            continue;
+        }
+        unsigned long at = readyAt(channel);
+        if ((long)(at - next) < 0) {
+            next = at;
+        }
+    }
+    return next;
+}
+
+/**
+ * Time the application can sleep before calling update() again
+ * @return Milliseconds until nextEventAt(), 0 if it has passed
+ */
+unsigned long DS2482Scheduler::timeToNextEvent() {
+    long remaining = (long)(nextEventAt() - bridge.getClock().millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+/**
+ * When the next step of a sensor's job is ready
+ * @param channel Channel number (0-7)
+ * @return millis() of the conversion deadline while converting, else the release
+ */
+unsigned long DS2482Scheduler::readyAt(uint8_t channel) {
+    const DS2482Task& task = tasks[channel];
+    return task.converting ? bridge.getConversionDue(channel) : task.release;
+}
+
+/**
+ * Start the conversion of a released job
+ * @param channel Channel number (0-7)
+ * @param now Current millis()
+ * @return true if the conversion started
+ */
+bool DS2482Scheduler::startConversion(uint8_t channel, unsigned long now) {
+    if (!bridge.startTemperatureConversion(channel)) {
+        if (errors[channel] < 255) {
+            errors[channel]++;
+        }
+        bridge.clearState();
+        finishJob(channel, now, true);
+        return false;
+    }
+
+    tasks[channel].converting = true;
+    tasks[channel].startMicros = bridge.getConversionStartMicros();
+    return true;
+}
+
+/**
+ * Read the result of a finished conversion
+ * @param channel Channel number (0-7)
+ * @param now Current millis()
+ * @param sample Receives the sample
+ * @return true if a valid sample was read
+ */
+bool DS2482Scheduler::readSample(uint8_t channel, unsigned long now, DS2482Sample* sample) {
+    int16_t raw;
+    uint32_t finish = bridge.getClock().micros();
+
+    if (!bridge.readTemperatureRaw(channel, &raw)) {
+        if (errors[channel] < 255) {
+            errors[channel]++;
+        }
+        bridge.clearState();
+        finishJob(channel, now, true);
+        return false;
+    }
+
+    sample->channel = channel;
+    sample->raw = raw;
+    sample->value = raw;
+    sample->timestamp = bridge.getClock().millis();
+    sample->startMicros = tasks[channel].startMicros;
+    sample->finishMicros = finish;
+
+    finishJob(channel, sample->timestamp, false);
+    return true;
+}
+
+/**
+ * Account for the end of a job and release the next one
+ * A job more than a period behind is not caught up; the schedule restarts
+ * from now instead of bursting through the backlog.
+ * @param channel Channel number (0-7)
+ * @param now millis() at completion
+ * @param failed true if the job produced no sample
+ */
+void DS2482Scheduler::finishJob(uint8_t channel, unsigned long now, bool failed) {
+    DS2482Task& task = tasks[channel];
+    unsigned long deadline = task.release + task.deadline;
+    long lateness = (long)(now - deadline);
+
+    if (failed || lateness > 0) {
+        if (task.misses < 0xFFFF) {
+            task.misses++;
+        }
+    }
+    if (!failed && task.completed < 0xFFFF) {
+        task.completed++;
+    }
+    if (lateness > 0 && (unsigned long)lateness > task.maxLateness) {
+        task.maxLateness = lateness;
+    }
+
+    task.converting = false;
+    task.release += task.period;
+    if ((long)(now - task.release) >= (long)task.period) {
+        task.release = now;
+    }
+}
@@ -0,0 +1,83 @@
+/**
+ * APADevices - DS2482Scheduler.h - Priority / deadline scheduling of DS2482 channels
+ *
+ * DS2482Scheduler samples each sensor on its own period instead of in equal
+ * round-robin sweeps. Every period releases a job - start a conversion, then
+ * read it - that must be finished by the sensor's deadline. Each update()
+ * performs at most one driver operation and picks it by:
+ *
+ *   1. priority class (0 is the most important)
+ *   2. earliest absolute deadline within the class
+ *
+ * so safety-critical probes are never queued behind informational ones: a
+ * pending low-priority read simply waits until no more urgent start or read
+ * is ready. Conversions of different channels overlap, which requires
+ * externally powered sensors.
+ *
+ *   DS2482Scheduler scheduler(ds2482);
+ *   scheduler.setSensor(0, 0, 1000, 900);   // channel 0: class 0, every 1 s, done within 900 ms
+ *   scheduler.setSensor(5, 2, 10000);       // channel 5: class 2, every 10 s
+ *
+ *   void loop() {
+ *       DS2482Sample sample;
+ *       if (scheduler.update(&sample)) { ... }
+ *   }
+ *
+ * nextEventAt() is the earliest release or conversion completion of all
+ * sensors; nothing is ready before it, so the application can sleep until
+ * then.
+ */
+
+#ifndef DS2482_SCHEDULER_H
+#define DS2482_SCHEDULER_H
+
+#include "DS2482.h"
+#include "DS2482Sampler.h"
+
+#define DS2482_PRIORITY_HIGHEST  0
+#define DS2482_PRIORITY_LOWEST   255
+
+// Scheduling parameters and state of one sensor
+struct DS2482Task {
+    // Configuration
+    uint8_t priority;           // Priority class, 0 = most important
+    unsigned long period;       // ms between samples, 0 = not scheduled
+    unsigned long deadline;     // ms after release the sample must be read by
+
+    // State
+    unsigned long release;      // millis() the current job was released
+    bool converting;            // Convert T issued for the current job
+    uint32_t startMicros;       // micros() of the Convert T
+    uint16_t completed;         // Jobs finished
+    uint16_t misses;            // Jobs finished after their deadline or dropped
+    unsigned long maxLateness;  // Worst completion time past the deadline, ms
+};
+
+class DS2482Scheduler {
+public:
+    DS2482Scheduler(DS2482& bridge);
+
+    // Configuration
+    void setSensor(uint8_t channel, uint8_t priority, unsigned long period, unsigned long deadline = 0);  // deadline 0 = period
+    void removeSensor(uint8_t channel);
+
+    // Operation
+    bool update(DS2482Sample* sample);  // Run the most urgent ready operation, true when a sample is returned
+    unsigned long nextEventAt();        // millis() when an operation is ready next
+    unsigned long timeToNextEvent();    // ms until then, 0 if one is ready now
+    const DS2482Task* getTask(uint8_t channel) { return channel < 8 ? &tasks[channel] : nullptr; }
+    uint8_t getErrorCount(uint8_t channel) { return channel < 8 ? errors[channel] : 0; }
+    void resetCounters();
+
+private:
+    DS2482& bridge;
+    DS2482Task tasks[8];
+    uint8_t errors[8];
+
+    unsigned long readyAt(uint8_t channel);
+    bool startConversion(uint8_t channel, unsigned long now);
+    bool readSample(uint8_t channel, unsigned long now, DS2482Sample* sample);
+    void finishJob(uint8_t channel, unsigned long now, bool failed);
+};
+
+#endif
@@ -0,0 +1,430 @@
+/**
+ * APADevices - DS2482Sim.cpp - Simulated DS2482-800 bridge with DS18B20 sensors
+ *
+ * Models the register file, read pointer and 1-Wire busy timing of the
+ * DS2482-800 together with a minimal DS18B20 on each channel (Skip ROM,
+ * Match ROM, Read ROM, Convert T, Read/Write Scratchpad). Results of 1-Wire
+ * operations are available immediately, but the 1WB status bit stays set for
+ * the time the operation would take on a real bus.
+ */
+
+#include "DS2482Sim.h"
+
+// Wire style write results
+#define SIM_ACK           0
+#define SIM_NACK_ADDRESS  2
+#define SIM_NACK_DATA     3
+#define SIM_BUS_ERROR     4
+
+static const uint8_t channelCodes[8] = {0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87};
+static const uint8_t readBackValues[8] = {0xB8, 0xB1, 0xAA, 0xA3, 0x9C, 0x95, 0x8E, 0x87};
+
+static DS2482ArduinoClock defaultClock;
+
+/**
+ * Constructor - bridge powered up with no sensors attached
+ * @param address I2C address the simulated bridge answers on
+ * @param clock Time base, nullptr for the Arduino clock; share it with the driver
+ */
+DS2482Sim::DS2482Sim(uint8_t address, DS2482Clock* clock) :
+    address(address), clock(clock ? clock : &defaultClock), i2cClock(0), busHeld(false) {
+    for (uint8_t i = 0; i < 8; i++) {
+        sensors[i].present = false;
+    }
+    deviceReset();
+}
+
+/**
+ * Transport initialization - nothing to do for the simulator
+ */
+void DS2482Sim::begin() {}
+
+/**
+ * Release a bus held by holdBus(), as the clock pulses of a real bus clear would
+ * @return true if the bus was held
+ */
+bool DS2482Sim::clearBus() {
+    bool held = busHeld;
+    busHeld = false;
+    return held;
+}
+
+/**
+ * Attach a DS18B20 to a channel
+ * @param channel Channel number (0-7)
+ * @param raw Temperature in 1/16 °C latched by conversions
+ * @param resolution Conversion resolution in bits (9-12)
+ */
+void DS2482Sim::attachSensor(uint8_t channel, int16_t raw, uint8_t resolution) {
+    if (channel > 7) {
+        return;
+    }
+    Sensor& sensor = sensors[channel];
+    sensor.present = true;
+    sensor.resolution = constrain(resolution, 9, 12);
+    sensor.temperature = raw;
+
+    // ROM: DS18B20 family code, serial derived from bridge address and channel
+    static const uint8_t serial[6] = {0x00, 0x00, 'P', 'A', 0x00, 0x00};
+    sensor.rom[0] = 0x28;
+    for (uint8_t i = 0; i < 6; i++) {
+        sensor.rom[i + 1] = serial[i];
+    }
+    sensor.rom[1] = channel;
+    sensor.rom[2] = address;
+    sensor.rom[7] = DS2482::crc8(sensor.rom, 7);
+
+    sensorPowerOn(sensor);
+}
+
+/**
+ * Remove the sensor from a channel
+ * @param channel Channel number (0-7)
+ */
+void DS2482Sim::detachSensor(uint8_t channel) {
+    if (channel <= 7) {
+        sensors[channel].present = false;
+    }
+}
+
+/**
+ * Change the temperature seen by a sensor
+ * @param channel Channel number (0-7)
+ * @param raw Temperature in 1/16 °C
+ */
+void DS2482Sim::setTemperature(uint8_t channel, int16_t raw) {
+    if (channel <= 7) {
+        sensors[channel].temperature = raw;
+    }
+}
+
+/**
+ * Give an attached sensor another ROM code, e.g. a DS1822 family code
+ * The sensor keeps behaving like a DS18B20, which the DS1822 matches.
+ * @param channel Channel number (0-7)
+ * @param rom Family code followed by the 48-bit serial, 7 bytes
+ */
+void DS2482Sim::setRom(uint8_t channel, const uint8_t* rom) {
+    if (channel > 7) {
+        return;
+    }
+    Sensor& sensor = sensors[channel];
+    for (uint8_t i = 0; i < 7; i++) {
+        sensor.rom[i] = rom[i];
+    }
+    sensor.rom[7] = DS2482::crc8(sensor.rom, 7);
+}
+
+/**
+ * Power cycle the bridge and every attached sensor
+ */
+void DS2482Sim::powerCycle() {
+    deviceReset();
+    for (uint8_t i = 0; i < 8; i++) {
+        if (sensors[i].present) {
+            sensorPowerOn(sensors[i]);
+        }
+    }
+}
+
+/**
+ * Handle a write transaction addressed to the bridge
+ * @return 0 on ACK, 2 for an address NACK, 3 for a data NACK, 4 while the bus is held
+ */
+uint8_t DS2482Sim::write(uint8_t address, const uint8_t* data, uint8_t length) {
+    if (busHeld) {
+        return SIM_BUS_ERROR;
+    }
+    if (address != this->address) {
+        return SIM_NACK_ADDRESS;
+    }
+    transfer(length);
+    if (length == 0) {
+        return SIM_ACK;  // Address probe
+    }
+
+    uint8_t command = data[0];
+    uint8_t parameter = length > 1 ? data[1] : 0;
+
+    switch (command) {
+        case DS2482_CMD_RESET:
+            deviceReset();
+            return SIM_ACK;
+
+        case DS2482_CMD_SET_READ:
+            if (length < 2 || (parameter != DS2482_REG_STATUS && parameter != DS2482_REG_DATA &&
+                               parameter != DS2482_CHANNEL_READBACK && parameter != DS2482_REG_CONFIG)) {
+                return SIM_NACK_DATA;
+            }
+            readPointer = parameter;
+            return SIM_ACK;
+
+        case DS2482_CMD_WRITE_CONFIG:
+            if (length < 2 || busy() || (parameter >> 4) != (~parameter & 0x0F)) {
+                return SIM_NACK_DATA;
+            }
+            config = parameter & 0x0F;
+            status &= ~DS2482_STATUS_RST;
+            readPointer = DS2482_REG_CONFIG;
+            return SIM_ACK;
+
+        case DS2482_CMD_CHANNEL_SELECT:
+            if (length < 2 || busy()) {
+                return SIM_NACK_DATA;
+            }
+            for (uint8_t i = 0; i < 8; i++) {
+                if (channelCodes[i] == parameter) {
+                    channel = i;
+                    readPointer = DS2482_CHANNEL_READBACK;
+                    return SIM_ACK;
+                }
+            }
+            return SIM_NACK_DATA;
+
+        case DS2482_CMD_WIRE_RESET: {
+            if (busy()) {
+                return SIM_NACK_DATA;
+            }
+            Sensor& sensor = sensors[channel];
+            status &= ~(DS2482_STATUS_PPD | DS2482_STATUS_SD);
+            if (sensor.present) {
+                updateConversion(sensor);
+                sensor.phase = Phase::ROM_COMMAND;
+                status |= DS2482_STATUS_PPD;
+            }
+            readPointer = DS2482_REG_STATUS;
+            startBusy((config & DS2482_CONFIG_1WS) ? DS2482_1W_OD_RESET_US : DS2482_1W_RESET_US);
+            return SIM_ACK;
+        }
+
+        case DS2482_CMD_WRITE_BYTE:
+            if (length < 2 || busy()) {
+                return SIM_NACK_DATA;
+            }
+            sensorWrite(parameter);
+            readPointer = DS2482_REG_STATUS;
+            startBusy(8 * slotTime());
+            return SIM_ACK;
+
+        case DS2482_CMD_READ_BYTE:
+            if (busy()) {
+                return SIM_NACK_DATA;
+            }
+            readData = sensorRead();
+            readPointer = DS2482_REG_STATUS;
+            startBusy(8 * slotTime());
+            return SIM_ACK;
+
+        case DS2482_CMD_SINGLE_BIT: {
+            if (length < 2 || busy()) {
+                return SIM_NACK_DATA;
+            }
+            // A write-one slot samples the line: a converting DS18B20 holds it low
+            bool bit = (parameter & 0x80) != 0;
+            if (bit) {
+                Sensor& sensor = sensors[channel];
+                if (sensor.present) {
+                    updateConversion(sensor);
+                    if (sensor.phase == Phase::CONVERTING) {
+                        bit = false;
+                    }
+                }
+            }
+            status = bit ? (status | DS2482_STATUS_SBR) : (status & ~DS2482_STATUS_SBR);
+            readPointer = DS2482_REG_STATUS;
+            startBusy(slotTime());
+            return SIM_ACK;
+        }
+
+        default:
+            return SIM_NACK_DATA;
+    }
+}
+
+/**
+ * Handle a read transaction - every byte returns the register at the read pointer
+ * @return Number of bytes returned
+ */
+uint8_t DS2482Sim::read(uint8_t address, uint8_t* data, uint8_t length) {
+    if (busHeld || address != this->address) {
+        return 0;
+    }
+    transfer(length);
+
+    uint8_t value;
+    switch (readPointer) {
+        case DS2482_REG_DATA:    value = readData; break;
+        case DS2482_CHANNEL_READBACK: value = readBackValues[channel]; break;
+        case DS2482_REG_CONFIG:  value = config; break;
+        default:              value = status | (busy() ? DS2482_STATUS_1WB : 0); break;
+    }
+
+    for (uint8_t i = 0; i < length; i++) {
+        data[i] = value;
+    }
+    return length;
+}
+
+/**
+ * Check whether a 1-Wire operation is still in progress
+ */
+bool DS2482Sim::busy() {
+    return clock->micros() - busyStart < busyTime;
+}
+
+/**
+ * Mark the 1-Wire line busy for the duration of an operation
+ * @param duration Busy time in microseconds
+ */
+void DS2482Sim::startBusy(unsigned long duration) {
+    busyStart = clock->micros();
+    busyTime = duration;
+}
+
+/**
+ * Spend the time a transaction of the given payload length takes on the bus
+ * @param length Payload bytes, excluding the address byte
+ */
+void DS2482Sim::transfer(uint8_t length) {
+    if (i2cClock) {
+        uint32_t bits = (uint32_t)(length + 1) * DS2482_I2C_BITS_PER_BYTE + DS2482_I2C_BITS_PER_FRAME;
+        clock->delayMicroseconds((bits * 1000000UL) / i2cClock);
+    }
+}
+
+/**
+ * Device reset - registers return to their power-on values
+ */
+void DS2482Sim::deviceReset() {
+    status = DS2482_STATUS_RST | DS2482_STATUS_LL;  // Line idles high through the pullup
+    readData = 0xFF;
+    config = 0;
+    channel = 0;
+    readPointer = DS2482_REG_STATUS;
+    busyStart = clock->micros();
+    busyTime = 0;
+}
+
+/**
+ * Load the DS18B20 power-on scratchpad (85 °C, resolution from config)
+ */
+void DS2482Sim::sensorPowerOn(Sensor& sensor) {
+    static const uint8_t powerOnScratchpad[8] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10};
+    for (uint8_t i = 0; i < 8; i++) {
+        sensor.scratchpad[i] = powerOnScratchpad[i];
+    }
+    sensor.scratchpad[4] = 0x1F | ((sensor.resolution - 9) << 5);
+    sensor.scratchpad[8] = DS2482::crc8(sensor.scratchpad, 8);
+    sensor.phase = Phase::IDLE;
+    sensor.index = 0;
+    sensor.converting = false;
+    sensor.conversionStart = 0;
+}
+
+/**
+ * Latch the temperature once the conversion time has elapsed
+ */
+void DS2482Sim::updateConversion(Sensor& sensor) {
+    if (!sensor.converting) {
+        return;
+    }
+    if (clock->micros() - sensor.conversionStart < ((DS2482_CONVERSION_TIME_MS * 1000UL) >> (12 - sensor.resolution))) {
+        return;
+    }
+
+    // Undefined low bits read as zero at reduced resolution
+    int16_t raw = sensor.temperature & ~((1 << (12 - sensor.resolution)) - 1);
+    sensor.scratchpad[0] = raw & 0xFF;
+    sensor.scratchpad[1] = (raw >> 8) & 0xFF;
+    sensor.scratchpad[8] = DS2482::crc8(sensor.scratchpad, 8);
+    sensor.converting = false;
+    if (sensor.phase == Phase::CONVERTING) {
+        sensor.phase = Phase::IDLE;
+    }
+}
+
+/**
+ * Deliver a byte written on the selected channel to its sensor
+ */
+void DS2482Sim::sensorWrite(uint8_t value) {
+    Sensor& sensor = sensors[channel];
+    if (!sensor.present) {
+        return;
+    }
+    updateConversion(sensor);
+
+    switch (sensor.phase) {
+        case Phase::ROM_COMMAND:
+            sensor.index = 0;
+            if (value == 0xCC) {
+                sensor.phase = Phase::FUNCTION;       // Skip ROM
+            } else if (value == 0x33) {
+                sensor.phase = Phase::READ_ROM;       // Read ROM
+            } else if (value == 0x55) {
+                sensor.phase = Phase::MATCH_ROM;      // Match ROM
+            } else {
+                sensor.phase = Phase::IDLE;           // Search ROM and others unsupported
+            }
+            break;
+
+        case Phase::MATCH_ROM:
+            if (value != sensor.rom[sensor.index]) {
+                sensor.phase = Phase::IDLE;
+            } else if (++sensor.index == 8) {
+                sensor.phase = Phase::FUNCTION;
+            }
+            break;
+
+        case Phase::FUNCTION:
+            sensor.index = 0;
+            if (value == 0x44) {
+                sensor.phase = Phase::CONVERTING;     // Convert T
+                sensor.converting = true;
+                sensor.conversionStart = clock->micros();
+            } else if (value == 0xBE) {
+                sensor.phase = Phase::READ_SCRATCHPAD;
+            } else if (value == 0x4E) {
+                sensor.phase = Phase::WRITE_SCRATCHPAD;
+            } else {
+                sensor.phase = Phase::IDLE;           // Copy/Recall complete instantly
+            }
+            break;
+
+        case Phase::WRITE_SCRATCHPAD:
+            sensor.scratchpad[2 + sensor.index] = value;
+            if (sensor.index == 2) {
+                sensor.scratchpad[4] = (value & 0x60) | 0x1F;
+                sensor.resolution = 9 + ((value >> 5) & 0x03);
+            }
+            sensor.scratchpad[8] = DS2482::crc8(sensor.scratchpad, 8);
+            if (++sensor.index == 3) {
+                sensor.phase = Phase::IDLE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * Produce the byte the selected sensor drives onto the bus during a read
+ */
+uint8_t DS2482Sim::sensorRead() {
+    Sensor& sensor = sensors[channel];
+    if (!sensor.present) {
+        return 0xFF;
+    }
+    updateConversion(sensor);
+
+    switch (sensor.phase) {
+        case Phase::READ_SCRATCHPAD:
+            return sensor.index < 9 ? sensor.scratchpad[sensor.index++] : 0xFF;
+        case Phase::READ_ROM:
+            return sensor.index < 8 ? sensor.rom[sensor.index++] : 0xFF;
+        case Phase::CONVERTING:
+            return 0x00;
+        default:
+            return 0xFF;
+    }
+}
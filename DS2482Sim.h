@@ -0,0 +1,99 @@
+/**
+ * APADevices - DS2482Sim.h - Simulated DS2482-800 bridge with DS18B20 sensors
+ *
+ * DS2482Sim implements the DS2482Bus transport interface and answers the
+ * driver's I2C transactions the way a DS2482-800 would, including the
+ * 1-Wire busy time of every bus operation and the conversion time of the
+ * attached DS18B20 sensors. It lets benchmarks and examples run the real
+ * driver code without any hardware connected:
+ *
+ *   DS2482Sim sim;
+ *   DS2482 ds2482(0x18, &sim);
+ *   sim.attachSensor(0, 23 * 16);   // 23.0 °C on channel 0
+ *
+ * Every sensor starts with the 85 °C power-on scratchpad until its first
+ * conversion completes, like the real part. Timing uses the same constants
+ * as the driver and DS2482CostModel; setI2CClock() additionally charges the
+ * time each transaction would spend on a real I2C bus.
+ */
+
+#ifndef DS2482_SIM_H
+#define DS2482_SIM_H
+
+#include "DS2482.h"
+
+class DS2482Sim : public DS2482Bus {
+public:
+    DS2482Sim(uint8_t address = 0x18, DS2482Clock* clock = nullptr);
+
+    // DS2482Bus transport
+    void begin() override;
+    void setI2CClock(uint32_t clockHz) { i2cClock = clockHz; }  // 0 = transactions take no time
+    uint8_t write(uint8_t address, const uint8_t* data, uint8_t length) override;
+    uint8_t read(uint8_t address, uint8_t* data, uint8_t length) override;
+    bool clearBus() override;
+
+    // Sensor population
+    void attachSensor(uint8_t channel, int16_t raw, uint8_t resolution = 12);  // Raw value in 1/16 °C
+    void detachSensor(uint8_t channel);
+    void setTemperature(uint8_t channel, int16_t raw);  // Value latched by the next conversion
+    void setRom(uint8_t channel, const uint8_t* rom);   // Family code and serial (7 bytes); the CRC is added
+    void powerCycle();                                  // Reset bridge and sensors to power-on state
+    void holdBus() { busHeld = true; }                  // Hold SDA low as after an interrupted read, until clearBus()
+
+    // Bridge state, for checking the driver against the device
+    uint8_t getChannel() { return channel; }            // Selected 1-Wire channel
+    uint8_t getReadPointer() { return readPointer; }    // DS2482_REG_* or DS2482_CHANNEL_READBACK
+    uint8_t getConfig() { return config; }
+    uint8_t getStatus() { return status | (busy() ? DS2482_STATUS_1WB : 0); }
+
+private:
+    // Per-sensor 1-Wire protocol state
+    enum class Phase : uint8_t {
+        IDLE,           // Waiting for a 1-Wire reset
+        ROM_COMMAND,    // Reset seen, expecting a ROM command
+        MATCH_ROM,      // Receiving ROM code bytes
+        READ_ROM,       // Returning ROM code bytes
+        FUNCTION,       // Selected, expecting a function command
+        READ_SCRATCHPAD,
+        WRITE_SCRATCHPAD,
+        CONVERTING
+    };
+
+    struct Sensor {
+        bool present;
+        uint8_t resolution;
+        int16_t temperature;        // Raw value the next conversion will latch
+        uint8_t rom[8];
+        uint8_t scratchpad[9];
+        Phase phase;
+        uint8_t index;              // Byte index within ROM/scratchpad transfers
+        bool converting;            // Conversion runs on across 1-Wire resets
+        unsigned long conversionStart;
+    };
+
+    uint8_t address;
+    DS2482Clock* clock;         // Time base of busy and conversion times
+    uint32_t i2cClock;
+    uint8_t status;
+    uint8_t readData;
+    uint8_t config;
+    uint8_t channel;
+    uint8_t readPointer;
+    bool busHeld;               // SDA stuck low, every transaction fails
+    unsigned long busyStart;
+    unsigned long busyTime;
+    Sensor sensors[8];
+
+    bool busy();
+    void startBusy(unsigned long duration);
+    void transfer(uint8_t length);
+    unsigned long slotTime() { return (config & DS2482_CONFIG_1WS) ? DS2482_1W_OD_SLOT_US : DS2482_1W_SLOT_US; }
+    void deviceReset();
+    void sensorPowerOn(Sensor& sensor);
+    void updateConversion(Sensor& sensor);
+    void sensorWrite(uint8_t value);
+    uint8_t sensorRead();
+};
+
+#endif
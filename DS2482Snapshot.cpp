@@ -0,0 +1,185 @@
+/**
+ * APADevices - DS2482Snapshot.cpp - Time-aligned conversions across bridges
+ *
+ * trigger() works in rounds, one per channel number. Each round walks the
+ * bridges three times - select + start reset, presence + Skip ROM, Convert T -
+ * so the 1-Wire work of one bridge overlaps the I2C traffic to the others.
+ */
+
+#include "DS2482Snapshot.h"
+
+/**
+ * Constructor
+ * @param bridges Bridge list owned by the caller; set bridge and channels of each entry
+ * @param count Number of entries, at most DS2482_SNAPSHOT_MAX_BRIDGES
+ */
+DS2482Snapshot::DS2482Snapshot(DS2482SnapshotBridge* bridges, uint8_t count) :
+    bridges(bridges),
+    count(count > DS2482_SNAPSHOT_MAX_BRIDGES ? DS2482_SNAPSHOT_MAX_BRIDGES : count),
+    triggerStart(0),
+    skew(0),
+    failed(0) {
+}
+
+/**
+ * Start a conversion on every configured channel of every bridge
+ * Results of a previous snapshot that were not read yet are discarded.
+ * @return true if every configured channel started converting
+ */
+bool DS2482Snapshot::trigger() {
+    bool first = true;
+    skew = 0;
+    failed = 0;
+
+    for (uint8_t b = 0; b < count; b++) {
+        bridges[b].started = 0;
+        bridges[b].pending = 0;
+    }
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        uint8_t active = 0;  // Bit b: bridge b is converting this channel in this round
+
+        // Select the channel and start the 1-Wire reset everywhere first
+        for (uint8_t b = 0; b < count; b++) {
+            DS2482SnapshotBridge& entry = bridges[b];
+            if (!(entry.channels & (1 << channel))) {
+                continue;
+            }
+            entry.bridge->clearState();     // An earlier failure is not this channel's
+            // selectChannel() waits for a Convert T of the previous round
+            if (!entry.bridge->selectChannel(channel) ||
+                !entry.bridge->startWireReset()) {
+                channelFailed(entry);
+                continue;
+            }
+            active |= 1 << b;
+        }
+
+        // Collect presence, address all devices on the channel
+        for (uint8_t b = 0; b < count; b++) {
+            if (!(active & (1 << b))) {
+                continue;
+            }
+            DS2482SnapshotBridge& entry = bridges[b];
+            uint8_t status;
+            if (!entry.bridge->waitFor1Wire(&status) || !(status & DS2482_STATUS_PPD)) {
+                active &= ~(1 << b);
+                channelFailed(entry);
+                continue;
+            }
+            if (!entry.bridge->wireWriteByte(0xCC)) {  // Skip ROM
+                active &= ~(1 << b);
+                channelFailed(entry);
+            }
+        }
+
+        // Convert T, as close together as the bus allows
+        for (uint8_t b = 0; b < count; b++) {
+            if (!(active & (1 << b))) {
+                continue;
+            }
+            DS2482SnapshotBridge& entry = bridges[b];
+            if (!entry.bridge->wireWriteByte(0x44)) {  // Convert T
+                channelFailed(entry);
+                continue;
+            }
+            uint32_t now = entry.bridge->getClock().micros();
+
+            if (first) {
+                triggerStart = now;
+                first = false;
+            }
+            skew = now - triggerStart;
+            entry.startMicros[channel] = now;
+            entry.started |= 1 << channel;
+            entry.pending |= 1 << channel;
+        }
+    }
+
+    return failed == 0;
+}
+
+/**
+ * Number of conversions the last trigger() started
+ * @return Started channels summed over all bridges
+ */
+uint8_t DS2482Snapshot::getStartedCount() {
+    uint8_t started = 0;
+    for (uint8_t b = 0; b < count; b++) {
+        for (uint8_t channel = 0; channel < 8; channel++) {
+            if (bridges[b].started & (1 << channel)) {
+                started++;
+            }
+        }
+    }
+    return started;
+}
+
+/**
+ * Read one conversion whose conversion time has elapsed
+ * Channels are read in bridge order, then channel order. A channel that
+ * fails to read is counted in getFailedCount() and skipped.
+ * @param bridge Receives the index of the bridge in the bridge list
+ * @param sample Receives the sample; startMicros is the Convert T time
+ * @return false if no started conversion is ready to be read
+ */
+bool DS2482Snapshot::readNext(uint8_t* bridge, DS2482Sample* sample) {
+    for (uint8_t b = 0; b < count; b++) {
+        DS2482SnapshotBridge& entry = bridges[b];
+        uint32_t conversionMicros = (uint32_t)entry.bridge->getConversionTime() * 1000;
+
+        for (uint8_t channel = 0; channel < 8; channel++) {
+            if (!(entry.pending & (1 << channel))) {
+                continue;
+            }
+            uint32_t now = entry.bridge->getClock().micros();
+            if (now - entry.startMicros[channel] < conversionMicros) {
+                continue;
+            }
+
+            entry.pending &= ~(1 << channel);
+            int16_t raw;
+            if (!entry.bridge->readTemperatureRaw(channel, &raw)) {
+                channelFailed(entry);
+                continue;
+            }
+
+            *bridge = b;
+            sample->channel = channel;
+            sample->raw = raw;
+            sample->value = raw;
+            sample->timestamp = entry.bridge->getClock().millis();
+            sample->startMicros = entry.startMicros[channel];
+            sample->finishMicros = now;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Count a channel that could not be started or read and recover the bridge
+ * @param entry Bridge the channel belongs to
+ */
+void DS2482Snapshot::channelFailed(DS2482SnapshotBridge& entry) {
+    if (failed < 255) {
+        failed++;
+    }
+    entry.bridge->clearState();
+}
+
+/**
+ * Number of started channels that still have to be read
+ * @return Pending channels summed over all bridges
+ */
+uint8_t DS2482Snapshot::pendingCount() {
+    uint8_t pending = 0;
+    for (uint8_t b = 0; b < count; b++) {
+        for (uint8_t channel = 0; channel < 8; channel++) {
+            if (bridges[b].pending & (1 << channel)) {
+                pending++;
+            }
+        }
+    }
+    return pending;
+}
@@ -0,0 +1,66 @@
+/**
+ * APADevices - DS2482Snapshot.h - Time-aligned conversions across bridges
+ *
+ * DS2482Snapshot starts a temperature conversion (Skip ROM + Convert T) on
+ * every configured channel of every bridge as close together as possible,
+ * records when each one went out and the resulting skew, and then lets the
+ * application read the results at leisure.
+ *
+ * A DS2482-800 drives one channel at a time, so conversions on the channels
+ * of one bridge are necessarily staggered by a 1-Wire reset plus two bytes
+ * (about 2.5 ms at standard speed). Bridges, however, work in parallel: the
+ * snapshot issues channel n on all bridges before waiting on any of them, so
+ * adding bridges does not add skew.
+ *
+ *   DS2482SnapshotBridge bridges[2] = {{&ds2482a, 0xFF}, {&ds2482b, 0x0F}};
+ *   DS2482Snapshot snapshot(bridges, 2);
+ *
+ *   snapshot.trigger();                  // all conversions within ~20 ms
+ *   ...
+ *   uint8_t bridge;
+ *   DS2482Sample sample;
+ *   while (snapshot.readNext(&bridge, &sample)) { ... }
+ */
+
+#ifndef DS2482_SNAPSHOT_H
+#define DS2482_SNAPSHOT_H
+
+#include "DS2482.h"
+#include "DS2482Sampler.h"
+
+#define DS2482_SNAPSHOT_MAX_BRIDGES  8   // Address pins allow 8 bridges per I2C bus
+
+// One bridge taking part in a snapshot
+struct DS2482SnapshotBridge {
+    DS2482* bridge;
+    uint8_t channels;           // Bit n converts channel n
+    uint8_t started;            // Channels whose Convert T went out in the last trigger()
+    uint8_t pending;            // Started channels not read yet
+    uint32_t startMicros[8];    // micros() when Convert T was issued per channel
+};
+
+class DS2482Snapshot {
+public:
+    DS2482Snapshot(DS2482SnapshotBridge* bridges, uint8_t count);  // Caller-owned bridge list
+
+    bool trigger();                     // Start all conversions, false if any channel failed
+    uint8_t getStartedCount();          // Conversions started by the last trigger()
+    uint32_t getSkewMicros() { return skew; }       // First to last Convert T of the last trigger()
+    uint32_t getTriggerMicros() { return triggerStart; }  // micros() of the first Convert T
+    uint8_t getFailedCount() { return failed; }     // Channels that failed to start or read
+
+    bool isComplete() { return pendingCount() == 0; }  // Every started channel was read
+    bool readNext(uint8_t* bridge, DS2482Sample* sample);  // Read one finished conversion, false if none ready
+
+private:
+    DS2482SnapshotBridge* bridges;
+    uint8_t count;
+    uint32_t triggerStart;
+    uint32_t skew;
+    uint8_t failed;
+
+    void channelFailed(DS2482SnapshotBridge& entry);
+    uint8_t pendingCount();
+};
+
+#endif
@@ -0,0 +1,268 @@
+/**
+ * APADevices - DS2482Stream.cpp - Compact binary encoding of temperature samples
+ *
+ * Kept free of Arduino headers so the decoder can be built on a host.
+ */
+
+#include "DS2482Stream.h"
+
+// Largest payload the length byte can describe
+#define STREAM_MAX_PAYLOAD  255
+
+/**
+ * Constructor
+ * @param buffer Frame buffer owned by the caller
+ * @param size Buffer size; frames never exceed DS2482_STREAM_MAX_FRAME bytes.
+ *             A buffer too small for an empty frame is never written.
+ */
+DS2482StreamEncoder::DS2482StreamEncoder(uint8_t* buffer, uint16_t size) :
+    buffer(buffer),
+    size(size < DS2482_STREAM_HEADER_SIZE + DS2482_STREAM_CRC_SIZE ? 0 :
+         size > DS2482_STREAM_MAX_FRAME ? DS2482_STREAM_MAX_FRAME : size),
+    length(0),
+    count(0),
+    lastTimestamp(0),
+    seen(0) {
+}
+
+/**
+ * Start a new, empty frame
+ * @param bridge I2C address of the bridge the samples come from
+ */
+void DS2482StreamEncoder::begin(uint8_t bridge) {
+    if (size == 0) {
+        return;
+    }
+    buffer[0] = DS2482_STREAM_SYNC;
+    buffer[1] = 0;
+    buffer[2] = bridge;
+    buffer[3] = 0;
+    length = DS2482_STREAM_HEADER_SIZE;
+    count = 0;
+    lastTimestamp = 0;
+    seen = 0;
+}
+
+/**
+ * Append a sample to the current frame
+ * Timestamps must not go backwards by more than the millis() wrap allows;
+ * the difference is taken modulo 2^32.
+ * @param channel Channel number (0-7)
+ * @param timestamp millis() of the sample
+ * @param raw Temperature in 1/16 °C
+ * @return false if the sample does not fit; finish() the frame and begin a new one.
+ *         Also false while no frame was begun.
+ */
+bool DS2482StreamEncoder::add(uint8_t channel, uint32_t timestamp, int16_t raw) {
+    if (length == 0 || channel > 7 || count == 0xFF) {
+        return false;
+    }
+
+    uint8_t record[13];
+    uint8_t used = 0;
+    uint32_t dt = 0;
+
+    if (count == 0) {
+        used += putVarint(record, timestamp);
+    } else {
+        dt = timestamp - lastTimestamp;
+        if (dt > DS2482_STREAM_MAX_DT) {
+            return false;
+        }
+    }
+
+    int32_t delta = (int32_t)raw - ((seen & (1 << channel)) ? lastRaw[channel] : 0);
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+
+    used += putVarint(record + used, (dt << 3) | channel);
+    used += putVarint(record + used, zigzag);
+
+    if (length - 2 + used > STREAM_MAX_PAYLOAD ||
+        length + used + DS2482_STREAM_CRC_SIZE > size) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < used; i++) {
+        buffer[length++] = record[i];
+    }
+    count++;
+    lastTimestamp = timestamp;
+    lastRaw[channel] = raw;
+    seen |= 1 << channel;
+    return true;
+}
+
+/**
+ * Close the current frame by filling in length, count and CRC
+ * @return Total frame length in bytes, ready to send from the start of the buffer;
+ *         0 if no frame was begun
+ */
+uint16_t DS2482StreamEncoder::finish() {
+    if (length == 0) {
+        return 0;
+    }
+    buffer[1] = (uint8_t)(length - 2);
+    buffer[3] = count;
+    uint16_t crc = crc16(buffer + 1, length - 1);
+    buffer[length] = crc & 0xFF;
+    buffer[length + 1] = crc >> 8;
+    return length + DS2482_STREAM_CRC_SIZE;
+}
+
+/**
+ * Write an unsigned value as a base-128 varint
+ * @param out Destination, at least 5 bytes
+ * @param value Value to encode
+ * @return Bytes written
+ */
+uint8_t DS2482StreamEncoder::putVarint(uint8_t* out, uint32_t value) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+/**
+ * Calculate CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+ * @param data Bytes to check
+ * @param length Number of bytes
+ * @return CRC value
+ */
+uint16_t DS2482StreamEncoder::crc16(const uint8_t* data, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * Constructor
+ */
+DS2482StreamDecoder::DS2482StreamDecoder() :
+    frame(nullptr),
+    end(0),
+    position(0),
+    bridge(0),
+    count(0),
+    remaining(0),
+    timestamp(0),
+    first(true) {
+}
+
+/**
+ * Total size of a frame from its first two bytes
+ * Use it to know how many bytes to collect after finding the sync byte.
+ * @param header First two bytes of the frame
+ * @return Frame length including sync, length and CRC, 0 if header is not a frame start
+ */
+uint16_t DS2482StreamDecoder::frameLength(const uint8_t* header) {
+    if (header[0] != DS2482_STREAM_SYNC || header[1] < DS2482_STREAM_HEADER_SIZE - 2) {
+        return 0;
+    }
+    return 2 + header[1] + DS2482_STREAM_CRC_SIZE;
+}
+
+/**
+ * Check a received frame and prepare to read its samples with next()
+ * The frame is read in place and must stay valid while samples are read.
+ * @param frame Frame bytes starting at the sync byte
+ * @param length Number of bytes available
+ * @return false if the frame is truncated or its CRC does not match
+ */
+bool DS2482StreamDecoder::decode(const uint8_t* frame, uint16_t length) {
+    this->frame = nullptr;
+    remaining = 0;
+
+    if (length < DS2482_STREAM_HEADER_SIZE + DS2482_STREAM_CRC_SIZE) {
+        return false;
+    }
+    uint16_t expected = frameLength(frame);
+    if (expected == 0 || expected > length) {
+        return false;
+    }
+
+    end = expected - DS2482_STREAM_CRC_SIZE;
+    uint16_t crc = frame[end] | (frame[end + 1] << 8);
+    if (DS2482StreamEncoder::crc16(frame + 1, end - 1) != crc) {
+        return false;
+    }
+
+    this->frame = frame;
+    bridge = frame[2];
+    count = frame[3];
+    remaining = count;
+    position = DS2482_STREAM_HEADER_SIZE;
+    timestamp = 0;
+    first = true;
+    for (uint8_t i = 0; i < 8; i++) {
+        lastRaw[i] = 0;
+    }
+    return true;
+}
+
+/**
+ * Read the next sample of the decoded frame
+ * @param channel Receives the channel number
+ * @param timestamp Receives millis() of the sample
+ * @param raw Receives the temperature in 1/16 °C
+ * @return false when all samples were read or the payload is malformed
+ */
+bool DS2482StreamDecoder::next(uint8_t* channel, uint32_t* timestamp, int16_t* raw) {
+    if (!frame || remaining == 0) {
+        return false;
+    }
+
+    uint32_t value;
+    if (first) {
+        if (!getVarint(&value)) {
+            return false;
+        }
+        this->timestamp = value;
+        first = false;
+    }
+
+    uint32_t zigzag;
+    if (!getVarint(&value) || !getVarint(&zigzag)) {
+        remaining = 0;
+        return false;
+    }
+
+    uint8_t ch = value & 0x07;
+    this->timestamp += value >> 3;
+    int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    lastRaw[ch] = (int16_t)(lastRaw[ch] + delta);
+    remaining--;
+
+    *channel = ch;
+    *timestamp = this->timestamp;
+    *raw = lastRaw[ch];
+    return true;
+}
+
+/**
+ * Read a base-128 varint from the payload
+ * @param value Receives the decoded value
+ * @return false if the varint runs past the payload or exceeds 32 bits
+ */
+bool DS2482StreamDecoder::getVarint(uint32_t* value) {
+    uint32_t result = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (position >= end) {
+            return false;
+        }
+        uint8_t b = frame[position++];
+        result |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
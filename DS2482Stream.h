@@ -0,0 +1,95 @@
+/**
+ * APADevices - DS2482Stream.h - Compact binary encoding of temperature samples
+ *
+ * DS2482StreamEncoder packs samples into self-contained frames for radio or
+ * serial uplinks; DS2482StreamDecoder unpacks them again. A sample costs
+ * about 3 bytes instead of the 7 of a plain struct. Both classes only depend
+ * on <stdint.h>, so the decoder compiles unchanged in a host-side tool.
+ *
+ * Frame layout:
+ *
+ *   0xA5                     sync byte
+ *   length                   number of payload bytes that follow
+ *   payload:
+ *     bridge                 I2C address of the bridge
+ *     count                  number of samples
+ *     varint timestamp       millis() of the first sample
+ *     count x record:
+ *       varint (dt << 3) | channel    ms since the previous sample, channel 0-7
+ *       zig-zag varint raw delta      change in 1/16 °C since the previous
+ *                                     sample of the same channel in this frame
+ *                                     (first sample of a channel: from 0)
+ *   crc16                    CRC-16/CCITT over length and payload, LSB first
+ *
+ * Varints are little-endian base-128, 7 bits per byte, high bit set on all
+ * but the last byte. Frames never reference earlier frames, so a lost frame
+ * only loses its own samples.
+ *
+ *   uint8_t buffer[64];
+ *   DS2482StreamEncoder encoder(buffer, sizeof(buffer));
+ *   encoder.begin(0x18);
+ *   encoder.add(sample.channel, sample.timestamp, sample.value);
+ *   uint8_t length = encoder.finish();   // send buffer[0..length)
+ */
+
+#ifndef DS2482_STREAM_H
+#define DS2482_STREAM_H
+
+#include <stdint.h>
+
+#define DS2482_STREAM_SYNC          0xA5
+#define DS2482_STREAM_HEADER_SIZE   4       // sync, length, bridge, count
+#define DS2482_STREAM_CRC_SIZE      2
+#define DS2482_STREAM_MAX_DT        0x1FFFFFFFUL  // Largest gap between samples in one frame, ms
+#define DS2482_STREAM_MAX_FRAME     (2 + 255 + DS2482_STREAM_CRC_SIZE)
+
+class DS2482StreamEncoder {
+public:
+    DS2482StreamEncoder(uint8_t* buffer, uint16_t size);  // Caller-owned frame buffer
+
+    void begin(uint8_t bridge);                            // Start a new frame
+    bool add(uint8_t channel, uint32_t timestamp, int16_t raw);  // false if the frame is full or not begun
+    uint16_t finish();                                     // Close the frame, returns its length (0 if not begun)
+    uint8_t getCount() { return count; }                   // Samples in the current frame
+    uint16_t getLength() { return length; }                // Bytes used so far
+
+    static uint16_t crc16(const uint8_t* data, uint16_t length);  // CRC-16/CCITT, initial 0xFFFF
+
+private:
+    uint8_t* buffer;
+    uint16_t size;
+    uint16_t length;            // 0 until begin()
+    uint8_t count;
+    uint32_t lastTimestamp;
+    int16_t lastRaw[8];
+    uint8_t seen;               // Bit n set once channel n is in the frame
+
+    uint8_t putVarint(uint8_t* out, uint32_t value);
+};
+
+class DS2482StreamDecoder {
+public:
+    DS2482StreamDecoder();
+
+    bool decode(const uint8_t* frame, uint16_t length);   // Validate a frame, false if damaged
+    bool next(uint8_t* channel, uint32_t* timestamp, int16_t* raw);  // false after the last sample
+    uint8_t getBridge() { return bridge; }
+    uint8_t getCount() { return count; }
+
+    static uint16_t frameLength(const uint8_t* header);    // Total frame size from the first 2 bytes, 0 if no sync
+
+private:
+    const uint8_t* frame;
+    uint16_t end;               // Offset of the CRC
+    uint16_t position;
+    uint8_t bridge;
+    uint8_t count;
+    uint8_t remaining;
+    uint32_t timestamp;
+    int16_t lastRaw[8];
+    bool first;
+
+    bool getVarint(uint32_t* value);
+};
+
+#endif
@@ -0,0 +1,224 @@
+/**
+ * APADevices - DS2482Trace.cpp - Recording DS2482 transport for wire-level tests
+ *
+ * A token is written as soon as its transaction returns. A repeat only
+ * rewrites the count behind the last token, so recording costs no more than
+ * a few characters per transaction and never moves earlier text.
+ */
+
+#include "DS2482Trace.h"
+
+/**
+ * Constructor
+ * @param target Transport the traffic is forwarded to
+ */
+DS2482TraceBus::DS2482TraceBus(DS2482Bus& target) :
+    target(target),
+    buffer(nullptr),
+    size(0) {
+    clear();
+}
+
+/**
+ * Record into a caller-owned text buffer
+ * @param buffer Text buffer, nullptr to only keep the counters
+ * @param size Buffer size in bytes, terminator included
+ */
+void DS2482TraceBus::attachBuffer(char* buffer, uint16_t size) {
+    this->buffer = size ? buffer : nullptr;
+    this->size = this->buffer ? size : 0;
+    clear();
+}
+
+/**
+ * Empty the text and reset the counters
+ */
+void DS2482TraceBus::clear() {
+    length = 0;
+    truncated = false;
+    stats = DS2482BusStats();
+    lastValid = false;
+    repeats = 0;
+    tokenStart = 0;
+    tokenEnd = 0;
+    if (buffer) {
+        buffer[0] = '\0';
+    }
+}
+
+/**
+ * Forward a write and record it
+ * @return 0 on ACK, Wire error code otherwise
+ */
+uint8_t DS2482TraceBus::write(uint8_t address, const uint8_t* data, uint8_t length) {
+    uint8_t result = target.write(address, data, length);
+    stats.transactions++;
+    stats.bytesWritten += length;
+    if (result != 0) {
+        stats.failures++;
+    }
+    record(false, address, data, length, result != 0);
+    return result;
+}
+
+/**
+ * Forward a read and record the bytes received
+ * @return Number of bytes received
+ */
+uint8_t DS2482TraceBus::read(uint8_t address, uint8_t* data, uint8_t length) {
+    uint8_t received = target.read(address, data, length);
+    stats.transactions++;
+    stats.bytesRead += received;
+    if (received < length) {
+        stats.failures++;
+    }
+    record(true, address, data, received, received < length);
+    return received;
+}
+
+/**
+ * Forward a bus clear and record it
+ * @return true if SDA was stuck
+ */
+bool DS2482TraceBus::clearBus() {
+    bool cleared = target.clearBus();
+    lastValid = false;
+    if (!truncated && buffer) {
+        uint16_t start = length;
+        if (!append(length ? " C" : "C")) {
+            cut(start);
+        }
+    }
+    return cleared;
+}
+
+/**
+ * Number of transactions a trace text stands for
+ * Repeat counts are expanded; bus clears are not transactions.
+ * @param trace Text in the format written by DS2482TraceBus
+ * @return Sum over all tokens
+ */
+uint32_t DS2482TraceBus::countTransactions(const char* trace) {
+    uint32_t count = 0;
+    while (*trace) {
+        while (*trace == ' ') {
+            trace++;
+        }
+        if (*trace == '\0') {
+            break;
+        }
+
+        bool transaction = *trace == 'W' || *trace == 'R';
+        uint32_t repeat = 1;
+        while (*trace && *trace != ' ') {
+            if (*trace == '*') {
+                repeat = strtoul(trace + 1, nullptr, 10);
+            }
+            trace++;
+        }
+        if (transaction) {
+            count += repeat;
+        }
+    }
+    return count;
+}
+
+/**
+ * Add a transaction to the text, folding it into the last token if equal
+ */
+void DS2482TraceBus::record(bool read, uint8_t address, const uint8_t* data, uint8_t length, bool failed) {
+    if (truncated || !buffer) {
+        return;
+    }
+
+    if (isRepeat(read, address, data, length, failed) && repeats < 0xFFFF) {
+        repeats++;
+        this->length = tokenEnd;
+        char count[8];
+        snprintf(count, sizeof(count), "*%u", (unsigned)repeats);
+        if (!append(count)) {
+            cut(tokenStart);
+        }
+        return;
+    }
+
+    tokenStart = this->length;
+    bool fits = (!tokenStart || append(" ")) &&
+                append(read ? "R" : "W") &&
+                appendHex(address) &&
+                append(":");
+    for (uint8_t i = 0; fits && i < length; i++) {
+        fits = appendHex(data[i]);
+    }
+    if (fits && failed) {
+        fits = append("!");
+    }
+    if (!fits) {
+        cut(tokenStart);
+        return;
+    }
+    tokenEnd = this->length;
+
+    lastValid = length <= DS2482_TRACE_FOLD_BYTES;
+    lastRead = read;
+    lastFailed = failed;
+    lastAddress = address;
+    lastLength = length;
+    for (uint8_t i = 0; lastValid && i < length; i++) {
+        lastData[i] = data[i];
+    }
+    repeats = 1;
+}
+
+/**
+ * Check whether a transaction repeats the last token exactly
+ */
+bool DS2482TraceBus::isRepeat(bool read, uint8_t address, const uint8_t* data, uint8_t length, bool failed) {
+    if (!lastValid || read != lastRead || failed != lastFailed ||
+        address != lastAddress || length != lastLength) {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        if (data[i] != lastData[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Append text if it fits, terminator included
+ * @return false if the buffer is full; nothing is written then
+ */
+bool DS2482TraceBus::append(const char* text) {
+    uint16_t add = strlen(text);
+    if (!buffer || length + add >= size) {
+        return false;
+    }
+    memcpy(buffer + length, text, add + 1);
+    length += add;
+    return true;
+}
+
+/**
+ * Append a byte as two uppercase hex digits
+ * @return false if the buffer is full
+ */
+bool DS2482TraceBus::appendHex(uint8_t value) {
+    static const char digits[] = "0123456789ABCDEF";
+    char text[3] = {digits[value >> 4], digits[value & 0x0F], '\0'};
+    return append(text);
+}
+
+/**
+ * End the text at a token boundary and stop recording into it
+ * @param at Text length to keep
+ */
+void DS2482TraceBus::cut(uint16_t at) {
+    length = at;
+    if (buffer) {
+        buffer[length] = '\0';
+        truncated = true;
+    }
+    lastValid = false;
+}
@@ -0,0 +1,87 @@
+/**
+ * APADevices - DS2482Trace.h - Recording DS2482 transport for wire-level tests
+ *
+ * DS2482TraceBus sits between the driver and another transport (the real
+ * DS2482WireBus, DS2482Sim or DS2482FaultBus) and writes down every
+ * transaction it forwards as text, so the exact I2C traffic of a call can be
+ * printed, compared with a known-good ("golden") trace and counted:
+ *
+ *   DS2482Sim sim;
+ *   DS2482TraceBus trace(sim);
+ *   DS2482 ds2482(0x18, &trace);
+ *   char text[256];
+ *   trace.attachBuffer(text, sizeof(text));
+ *   ds2482.readStatus();
+ *   // text is now "W18:E1F0 R18:18"
+ *
+ * Trace format, one space-separated token per transaction:
+ *
+ *   W18:E1F0     write of E1 F0 to address 0x18
+ *   R18:18       read of one byte from 0x18, which returned 18
+ *   ...!         the write was not acknowledged, or the read came back short
+ *   ...*4        the same transaction with the same result four times in a row
+ *   C            the bus was cleared (clearBus())
+ *
+ * Bytes are two uppercase hex digits. Repeats are folded so that status
+ * polling does not swamp the trace; they still count as separate
+ * transactions. The text stays NUL-terminated; when the buffer is full it
+ * ends at the last complete token and isTruncated() is set, while the
+ * counters keep going.
+ */
+
+#ifndef DS2482_TRACE_H
+#define DS2482_TRACE_H
+
+#include "DS2482.h"
+
+#define DS2482_TRACE_FOLD_BYTES  4     // Longest transaction folded into a repeat count
+
+class DS2482TraceBus : public DS2482Bus {
+public:
+    DS2482TraceBus(DS2482Bus& target);
+
+    // DS2482Bus transport
+    void begin() override { target.begin(); }
+    uint8_t write(uint8_t address, const uint8_t* data, uint8_t length) override;
+    uint8_t read(uint8_t address, uint8_t* data, uint8_t length) override;
+    bool clearBus() override;
+
+    // Recording
+    void attachBuffer(char* buffer, uint16_t size);     // Caller-owned text, nullptr to only count
+    void clear();                                       // Empty the text and reset the counters
+    const char* getTrace() { return buffer ? buffer : ""; }
+    uint16_t getLength() { return length; }
+    bool isTruncated() { return truncated; }            // Transactions were left out of the text
+
+    // Counters since clear(), same definitions as DS2482::getBusStats()
+    const DS2482BusStats& getStats() { return stats; }
+
+    static uint32_t countTransactions(const char* trace);  // Transactions written in a trace text
+
+private:
+    DS2482Bus& target;
+    char* buffer;
+    uint16_t size;
+    uint16_t length;
+    bool truncated;
+    DS2482BusStats stats;
+
+    // Last transaction, for folding repeats
+    bool lastValid;
+    bool lastRead;
+    bool lastFailed;
+    uint8_t lastAddress;
+    uint8_t lastLength;
+    uint8_t lastData[DS2482_TRACE_FOLD_BYTES];
+    uint16_t repeats;
+    uint16_t tokenStart;        // Text length before the last token
+    uint16_t tokenEnd;          // Text length before its repeat count
+
+    void record(bool read, uint8_t address, const uint8_t* data, uint8_t length, bool failed);
+    bool isRepeat(bool read, uint8_t address, const uint8_t* data, uint8_t length, bool failed);
+    bool append(const char* text);
+    bool appendHex(uint8_t value);
+    void cut(uint16_t at);      // Drop the text from at on and stop recording
+};
+
+#endif
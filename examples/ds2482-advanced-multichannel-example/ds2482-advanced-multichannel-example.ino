@@ -192,16 +192,30 @@ void moveToNextChannel() {
 
 /**
  * Recover from device error state
+ * recover() tries a 1-Wire reset first and only falls back to a device reset
+ * or Wire re-initialisation when the cheaper tiers do not help
  */
 void recoverFromError() {
-    Serial.println("Recovering from error state...");
-    ds2482.reset();
-    delay(100);
-    
-    if (ds2482.begin()) {
-        Serial.println("Device recovered successfully");
-    } else {
-        Serial.println("Device recovery failed");
+    Serial.print("Recovering from error state... ");
+    switch (ds2482.recover()) {
+        case DS2482Recovery::WIRE_RESET:
+            Serial.println("recovered by 1-Wire reset");
+            break;
+        case DS2482Recovery::RESELECT:
+            Serial.println("recovered by channel re-select");
+            break;
+        case DS2482Recovery::DEVICE_RESET:
+            Serial.println("recovered by device reset");
+            break;
+        case DS2482Recovery::BUS_REINIT:
+            Serial.println("recovered by Wire re-initialisation");
+            break;
+        case DS2482Recovery::BUS_CLEAR:
+            Serial.println("recovered by clearing a stuck SDA");
+            break;
+        case DS2482Recovery::FAILED:
+            Serial.println("recovery failed");
+            break;
     }
 }
 
@@ -0,0 +1,287 @@
+/*
+ * APADevices - DS2482 Bus Cost Benchmark
+ *
+ * This sketch measures what each driver operation costs on the I2C bus:
+ * - Number of I2C transactions
+ * - Bytes on the wire (address bytes included)
+ * - Time per call with the bus clocked at 100 kHz and at 400 kHz
+ *
+ * By default the driver runs against DS2482Sim, a simulated DS2482-800 with
+ * a DS18B20 on every channel, on a virtual clock: no hardware is needed and
+ * every figure, times included, is the same on every run and every board.
+ * Set USE_SIMULATOR to 0 to benchmark a real bridge (connect one DS18B20
+ * per channel, 4.7kΩ pullup each); times are then measured with micros().
+ *
+ * Run the sketch before and after a driver change and compare the tables -
+ * fewer transactions per operation means faster sweeps on any I2C clock.
+ *
+ * The second table validates DS2482CostModel: every operation is predicted
+ * by the model and then measured with the bus running at 100 kHz.
+ *
+ * The last table shows the latency histograms the driver kept during all
+ * runs above: median, 99th percentile and worst case per operation. Tail
+ * latencies, not averages, decide whether a loop deadline holds.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sim.h"
+#include "DS2482Clock.h"
+#include "DS2482CostModel.h"
+
+#define USE_SIMULATOR 1
+
+#if USE_SIMULATOR
+DS2482VirtualClock virtualClock;
+DS2482Sim sim(0x18, &virtualClock);
+DS2482 ds2482(0x18, &sim, &virtualClock);
+#else
+DS2482 ds2482;
+#endif
+
+const uint16_t ITERATIONS = 20;  // Repetitions per single operation
+const uint32_t MODEL_CLOCK = 100000;  // I2C clock used for model validation
+
+DS2482Histogram histograms[DS2482_OP_COUNT];
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Bus Cost Benchmark");
+    Serial.println("-------------------------");
+
+#if USE_SIMULATOR
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        sim.attachSensor(channel, (20 + channel) * 16);
+    }
+#endif
+
+    if (!ds2482.begin()) {
+        Serial.println("Failed to initialize DS2482!");
+        while (1);
+    }
+    ds2482.attachHistograms(histograms);
+
+    Serial.println("Operation\tTrans\tBytes\t@100k us\t@400k us");
+
+    runBenchmark("selectChannel", opSelectChannel, ITERATIONS);
+    runBenchmark("wireReset", opWireReset, ITERATIONS);
+    runBenchmark("wireReadByte", opWireReadByte, ITERATIONS);
+    runBenchmark("readTemperature", opReadTemperature, ITERATIONS);
+    runSweepBenchmark();
+
+    runModelValidation();
+    printHistograms();
+
+    Serial.println("Done.");
+}
+
+void loop() {
+}
+
+// Single operations under test
+void opSelectChannel() { ds2482.selectChannel(3); }
+void opWireReset() { ds2482.wireReset(); }
+void opWireReadByte() { ds2482.wireReadByte(); }
+void opReadTemperature() { float temperature; ds2482.readTemperature(0, &temperature); }
+
+/**
+ * Set the I2C clock of the simulated or the real bus
+ */
+void setBusClock(uint32_t clockHz) {
+#if USE_SIMULATOR
+    sim.setI2CClock(clockHz);   // Transfers advance the virtual clock
+#else
+    Wire.setClock(clockHz);
+#endif
+}
+
+/**
+ * Run an operation repeatedly at 100 kHz and at 400 kHz and report per-call
+ * averages; transactions and bytes are those of the 100 kHz run
+ */
+void runBenchmark(const char* name, void (*operation)(), uint16_t iterations) {
+    unsigned long elapsed[2];
+    DS2482BusStats stats;
+
+    for (uint8_t fast = 0; fast < 2; fast++) {
+        setBusClock(fast ? 400000 : 100000);
+        ds2482.selectChannel(0);
+        ds2482.clearState();
+        ds2482.resetBusStats();
+
+        unsigned long start = ds2482.getClock().micros();
+        for (uint16_t i = 0; i < iterations; i++) {
+            operation();
+        }
+        elapsed[fast] = ds2482.getClock().micros() - start;
+        if (!fast) {
+            stats = ds2482.getBusStats();
+        }
+    }
+
+    printResult(name, stats, elapsed, iterations);
+}
+
+/**
+ * Convert and read all 8 channels one after another, at both clocks
+ * The conversion wait is excluded from the measured time; only the driver
+ * calls that touch the bus are timed.
+ */
+void runSweepBenchmark() {
+    unsigned long elapsed[2];
+    DS2482BusStats stats;
+    unsigned long total;
+
+    setBusClock(100000);
+    elapsed[0] = measureSweep(&total);
+    stats = ds2482.getBusStats();
+    setBusClock(400000);
+    elapsed[1] = measureSweep(&total);
+
+    printResult("8-channel sweep", stats, elapsed, 1);
+}
+
+/**
+ * Run one sequential sweep over all channels
+ * @param total Receives the sweep time including conversion waits
+ * @return Time spent inside driver calls that touch the bus
+ */
+unsigned long measureSweep(unsigned long* total) {
+    ds2482.clearState();
+    ds2482.resetBusStats();
+
+    DS2482Clock& clock = ds2482.getClock();
+    unsigned long elapsed = 0;
+    unsigned long sweepStart = clock.micros();
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        unsigned long start = clock.micros();
+        bool started = ds2482.startTemperatureConversion(channel);
+        elapsed += clock.micros() - start;
+
+        if (!started) {
+            Serial.print("Conversion failed on channel ");
+            Serial.println(channel);
+            continue;
+        }
+        while (!ds2482.checkConversionStatus()) {
+            clock.delayMicroseconds(DS2482_POLL_INTERVAL_US);
+        }
+
+        float temperature;
+        start = clock.micros();
+        ds2482.readTemperature(channel, &temperature);
+        elapsed += clock.micros() - start;
+    }
+    *total = clock.micros() - sweepStart;
+    return elapsed;
+}
+
+/**
+ * Compare DS2482CostModel predictions with measurements at MODEL_CLOCK
+ */
+void runModelValidation() {
+    DS2482CostModel model(MODEL_CLOCK);
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        model.setSensor(channel, DS2482_FAMILY_DS18B20, 12);
+    }
+
+    setBusClock(MODEL_CLOCK);
+
+    Serial.println("\nCost model validation @ 100 kHz");
+    Serial.println("Operation\tModel trans\tTrans\tModel us\tTime us");
+
+    // validate() selects channel 0 first; the model follows the same steps
+    model.selectChannel(0);
+    validate("selectChannel", opSelectChannel, model.selectChannel(3));
+    model.selectChannel(0);
+    validate("wireReset", opWireReset, model.wireReset());
+    model.selectChannel(0);
+    validate("readTemperature", opReadTemperature, model.readTemperature(0));
+
+    // predictSweep() models a sweep that is already running, so the
+    // measured one starts where the previous sweep would have ended
+    DS2482Prediction sweep = model.predictSweep();
+    ds2482.selectChannel(7);
+    unsigned long total;
+    measureSweep(&total);
+    printValidation("8-channel sweep", sweep, ds2482.getBusStats(), total);
+
+    Serial.print("Predicted sample rate per sensor: ");
+    Serial.print(model.maxSampleRateMilliHz(0));
+    Serial.println(" mHz");
+}
+
+/**
+ * Measure one call of an operation against its prediction
+ */
+void validate(const char* name, void (*operation)(), DS2482Prediction predicted) {
+    ds2482.selectChannel(0);
+    ds2482.clearState();
+    ds2482.resetBusStats();
+
+    unsigned long start = ds2482.getClock().micros();
+    operation();
+    unsigned long elapsed = ds2482.getClock().micros() - start;
+
+    printValidation(name, predicted, ds2482.getBusStats(), elapsed);
+}
+
+void printValidation(const char* name, const DS2482Prediction& predicted, const DS2482BusStats& stats, unsigned long elapsed) {
+    Serial.print(name);
+    Serial.print("\t");
+    Serial.print(predicted.transactions);
+    Serial.print("\t\t");
+    Serial.print(stats.transactions);
+    Serial.print("\t");
+    Serial.print(predicted.micros);
+    Serial.print("\t\t");
+    Serial.println(elapsed);
+}
+
+/**
+ * Print one table row, averaged over the given number of iterations
+ * @param elapsed Total time at 100 kHz and at 400 kHz
+ */
+void printResult(const char* name, const DS2482BusStats& stats, const unsigned long* elapsed, uint16_t iterations) {
+    Serial.print(name);
+    Serial.print("\t");
+    Serial.print(stats.transactions / iterations);
+    Serial.print("\t");
+    Serial.print(stats.wireBytes() / iterations);
+    Serial.print("\t");
+    Serial.print(elapsed[0] / iterations);
+    Serial.print("\t");
+    Serial.print(elapsed[1] / iterations);
+    if (stats.failures) {
+        Serial.print("\t(");
+        Serial.print(stats.failures);
+        Serial.print(" failed transactions)");
+    }
+    Serial.println();
+}
+
+/**
+ * Print count, median, 99th percentile and maximum of every histogram
+ */
+void printHistograms() {
+    static const char* const names[DS2482_OP_COUNT] = {
+        "selectChannel", "wireReset", "wireReadByte", "wireWriteByte", "acquisition", "timeouts"
+    };
+
+    Serial.println("\nLatency histograms");
+    Serial.println("Operation\tCount\tp50 us\tp99 us\tMax us");
+    for (uint8_t op = 0; op < DS2482_OP_COUNT; op++) {
+        const DS2482Histogram* histogram = ds2482.getHistogram((DS2482Op)op);
+        Serial.print(names[op]);
+        Serial.print("\t");
+        Serial.print(histogram->count());
+        Serial.print("\t");
+        Serial.print(histogram->percentileMicros(50));
+        Serial.print("\t");
+        Serial.print(histogram->percentileMicros(99));
+        Serial.print("\t");
+        Serial.println(histogram->maxMicros);
+    }
+}
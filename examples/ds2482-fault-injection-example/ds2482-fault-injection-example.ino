@@ -0,0 +1,181 @@
+/*
+ * APADevices - DS2482 Fault Injection Example
+ *
+ * This example runs the sampling engine through DS2482FaultBus, which
+ * injects I2C and 1-Wire failures on a seeded schedule:
+ * - 0.2 % of writes are NACKed
+ * - 0.5 % of bytes read from the data register get a bit flipped (CRC errors)
+ * - 0.05 % of 1-Wire commands leave 1WB stuck for 150 ms (timeouts)
+ * - 0.5 % of 1-Wire resets report no presence pulse
+ * - 0.01 % of writes are cut off with SDA stuck low; all traffic then fails
+ *   until recover() clears the bus
+ * - Every 30 seconds it prints throughput, failures, retries, the faults
+ *   injected and how long channels took to deliver a sample again after a
+ *   failure (recovery time), and which recover() tiers were needed
+ *
+ * Rerun with the same FAULT_SEED to reproduce a run; change the rates to
+ * benchmark recovery under harsher conditions.
+ *
+ * By default the faults are injected in front of DS2482Sim, so no hardware
+ * is needed. Set USE_SIMULATOR to 0 to inject them into the traffic to a
+ * real bridge (one DS18B20 per channel, 4.7kΩ pullup each).
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sampler.h"
+#include "DS2482FaultBus.h"
+
+#define USE_SIMULATOR 1
+
+const uint32_t FAULT_SEED = 12345;
+
+#if USE_SIMULATOR
+#include "DS2482Sim.h"
+DS2482Sim sim;
+DS2482FaultBus faults(sim, FAULT_SEED);
+#else
+DS2482WireBus wireBus;
+DS2482FaultBus faults(wireBus, FAULT_SEED);
+#endif
+
+DS2482 ds2482(0x18, &faults);
+DS2482Sampler sampler(ds2482);
+
+const unsigned long REPORT_INTERVAL = 30000;
+const uint8_t RECOVER_AFTER = 8;    // Consecutive failed reads before recover()
+
+unsigned long lastReport = 0;
+uint32_t samples = 0;
+uint8_t lastErrors[8];
+unsigned long failedAt[8];      // millis() of the first unrecovered failure, 0 = healthy
+unsigned long maxRecovery = 0;
+unsigned long totalRecovery = 0;
+uint16_t recoveries = 0;
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Fault Injection Example");
+
+#if USE_SIMULATOR
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        sim.attachSensor(channel, (18 + channel) * 16);
+    }
+#endif
+
+    // Bring the bridge up cleanly, then start injecting
+    faults.setEnabled(false);
+    if (!ds2482.begin()) {
+        Serial.println("Failed to initialize DS2482!");
+        while (1);
+    }
+    faults.setEnabled(true);
+
+    faults.setRate(DS2482Fault::NACK, 20);
+    faults.setRate(DS2482Fault::CORRUPT_READ, 50);
+    faults.setRate(DS2482Fault::HOLD_BUSY, 5);
+    faults.setRate(DS2482Fault::CLEAR_PRESENCE, 50);
+    faults.setRate(DS2482Fault::STUCK_BUS, 1);
+
+    sampler.setChannels(0xFF);
+    sampler.setMaxRetries(2);
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        lastErrors[channel] = 0;
+        failedAt[channel] = 0;
+    }
+    lastReport = millis();
+}
+
+void loop() {
+    DS2482Sample sample;
+    bool sampled = sampler.update(&sample);
+    unsigned long now = millis();
+
+    // Note the first failure of each channel
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        uint8_t errors = sampler.getErrorCount(channel);
+        if (errors != lastErrors[channel]) {
+            lastErrors[channel] = errors;
+            if (!failedAt[channel]) {
+                failedAt[channel] = now ? now : 1;
+            }
+        }
+    }
+
+    // A whole sweep without a reading: the bridge itself needs attention
+    if (sampler.getFailureStreak() >= RECOVER_AFTER) {
+        ds2482.recover();
+        sampler.resetFailureStreak();
+    }
+
+    if (sampled) {
+        samples++;
+        if (failedAt[sample.channel]) {
+            unsigned long recovery = now - failedAt[sample.channel];
+            failedAt[sample.channel] = 0;
+            totalRecovery += recovery;
+            recoveries++;
+            if (recovery > maxRecovery) {
+                maxRecovery = recovery;
+            }
+        }
+    }
+
+    if (now - lastReport >= REPORT_INTERVAL) {
+        printReport(now - lastReport);
+        lastReport = now;
+    }
+}
+
+/**
+ * Print throughput, failures and recovery times of the last interval
+ */
+void printReport(unsigned long elapsed) {
+    uint16_t failures = 0;
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        failures += sampler.getErrorCount(channel);
+    }
+
+    Serial.println();
+    Serial.print("Samples/min: ");
+    Serial.println(samples * 60000UL / elapsed);
+    Serial.print("Failed channel reads (total): ");
+    Serial.println(failures);
+    Serial.print("Reconverts (total): ");
+    Serial.println(sampler.getRetryCount());
+    Serial.print("Faults injected: NACK ");
+    Serial.print(faults.getInjected(DS2482Fault::NACK));
+    Serial.print(", corrupt ");
+    Serial.print(faults.getInjected(DS2482Fault::CORRUPT_READ));
+    Serial.print(", 1WB hold ");
+    Serial.print(faults.getInjected(DS2482Fault::HOLD_BUSY));
+    Serial.print(", no presence ");
+    Serial.print(faults.getInjected(DS2482Fault::CLEAR_PRESENCE));
+    Serial.print(", stuck bus ");
+    Serial.println(faults.getInjected(DS2482Fault::STUCK_BUS));
+    Serial.print("recover() tiers (total): 1-Wire reset ");
+    Serial.print(ds2482.getRecoveryCount(DS2482Recovery::WIRE_RESET));
+    Serial.print(", reselect ");
+    Serial.print(ds2482.getRecoveryCount(DS2482Recovery::RESELECT));
+    Serial.print(", device reset ");
+    Serial.print(ds2482.getRecoveryCount(DS2482Recovery::DEVICE_RESET));
+    Serial.print(", Wire reinit ");
+    Serial.print(ds2482.getRecoveryCount(DS2482Recovery::BUS_REINIT));
+    Serial.print(", bus clear ");
+    Serial.print(ds2482.getRecoveryCount(DS2482Recovery::BUS_CLEAR));
+    Serial.print(", failed ");
+    Serial.println(ds2482.getRecoveryCount(DS2482Recovery::FAILED));
+    Serial.print("Recovery ms: avg ");
+    Serial.print(recoveries ? totalRecovery / recoveries : 0);
+    Serial.print(", max ");
+    Serial.print(maxRecovery);
+    Serial.print(" (");
+    Serial.print(recoveries);
+    Serial.println(" recoveries)");
+
+    samples = 0;
+    faults.resetCounters();
+}
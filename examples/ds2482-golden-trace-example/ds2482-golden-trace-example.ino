@@ -0,0 +1,372 @@
+/*
+ * APADevices - DS2482 Golden Trace Test
+ *
+ * This sketch pins down the exact I2C traffic of every public driver call.
+ * Each call runs against the simulated bridge through DS2482TraceBus, from a
+ * fixed starting state and on a virtual clock, and its trace is compared
+ * with the golden trace checked in below:
+ * - A call whose traffic changed prints both traces and the first token
+ *   that differs, then the golden line to paste in if the change is intended
+ * - Every call reports its transaction count next to the golden one, and
+ *   the summary shows the total delta, so a change to selectChannel(),
+ *   readStatus() or the byte routines shows exactly what it saves on the bus
+ *
+ * Calls start from a power-cycled bridge with a DS18B20 on channel 0 (12 bit,
+ * 21.5 °C) and one on channel 3 (9 bit, -10 °C), and a fresh driver object
+ * after begin(), unless their setup says otherwise. The setup traffic is not
+ * part of the trace. A second bridge at 0x19 with a DS18B20 on channel 0
+ * shares the traced bus, for calls that interleave two bridges. See
+ * DS2482Trace.h for the trace format.
+ *
+ * To update the golden traces after an intended change, replace the lines of
+ * GOLDEN with the ones printed for the calls that differ.
+ *
+ * Runs on any board; no hardware is needed.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sim.h"
+#include "DS2482Clock.h"
+#include "DS2482Trace.h"
+
+const uint16_t TRACE_SIZE = 640;        // Longest trace, as text
+const uint16_t NO_GOLDEN = 0xFFFF;
+
+// One line per call: name, then its trace
+const char GOLDEN[] PROGMEM =
+    "begin W18:F0 R18:18 W18:D2F0 R18:00 W18:96 R18:09*4 R18:08*2\n"
+    "reset W18:F0 R18:18\n"
+    "wakeUp W18:96 R18:09*4 R18:08\n"
+    "warmStart R18:08\n"
+    "warmStart-powerUp R18:18 W18:D2F0 R18:00\n"
+    "warmStart-cold W18:F0 R18:18 W18:D2F0 R18:00 W18:96 R18:09*4 R18:08*2\n"
+    "readStatus W18:E1F0 R18:08\n"
+    "readStatus-again R18:08\n"
+    "selectChannel W18:C3C3 R18:A3\n"
+    "selectChannel-same\n"
+    "writeConfig W18:D2E1 R18:01\n"
+    "writeConfig-same W18:D2E1 R18:01\n"
+    "wireReset W18:B4 R18:0B*8 R18:0A\n"
+    "wireReset-empty W18:B4 R18:09*8 R18:08\n"
+    "startWireReset W18:B4 R18:0B*8 R18:0A\n"
+    "wireWriteBit W18:8780\n"
+    "wireReadBit W18:8780 R18:29 R18:28\n"
+    "wireWriteByte W18:A5CC\n"
+    "wireReadByte W18:96 R18:09*4 R18:08 W18:E1E1 R18:FF\n"
+    "startTemperatureConversion W18:B4 R18:0B*8 R18:0A W18:A5CC R18:0B*4 R18:0A W18:A544\n"
+    "checkConversionStatus\n"
+    "readScratchpad W18:B4 R18:0B*8 R18:0A W18:A5CC R18:0B*4 R18:0A W18:A5BE R18:0B*4 R18:0A W18:96 R18:0B*4 R18:0A W18:E1E1 R18:50 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:05 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:4B W18:96 R18:0B*4 R18:0A W18:E1E1 R18:46 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:7F W18:96 R18:0B*4 R18:0A W18:E1E1 R18:FF W18:96 R18:0B*4 R18:0A W18:E1E1 R18:0C W18:96 R18:0B*4 R18:0A W18:E1E1 R18:10 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:1C\n"
+    "readTemperatureRaw R18:0A W18:B4 R18:0B*8 R18:0A W18:A5CC R18:0B*4 R18:0A W18:A5BE R18:0B*4 R18:0A W18:96 R18:0B*4 R18:0A W18:E1E1 R18:58 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:01 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:4B W18:96 R18:0B*4 R18:0A W18:E1E1 R18:46 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:7F W18:96 R18:0B*4 R18:0A W18:E1E1 R18:FF W18:96 R18:0B*4 R18:0A W18:E1E1 R18:0C W18:96 R18:0B*4 R18:0A W18:E1E1 R18:10 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:C2\n"
+    "readTemperature R18:0A W18:B4 R18:0B*8 R18:0A W18:A5CC R18:0B*4 R18:0A W18:A5BE R18:0B*4 R18:0A W18:96 R18:0B*4 R18:0A W18:E1E1 R18:60 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:FF W18:96 R18:0B*4 R18:0A W18:E1E1 R18:4B W18:96 R18:0B*4 R18:0A W18:E1E1 R18:46 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:1F W18:96 R18:0B*4 R18:0A W18:E1E1 R18:FF W18:96 R18:0B*4 R18:0A W18:E1E1 R18:0C W18:96 R18:0B*4 R18:0A W18:E1E1 R18:10 W18:96 R18:0B*4 R18:0A W18:E1E1 R18:BF\n"
+    "runProgram-convert W18:B4 R18:0B*8 R18:0A W18:A5CC R18:0B*4 R18:0A W18:A544\n"
+    "runProgram-noPresence W18:C3E1 R18:B1 W18:B4 R18:09*8 R18:08\n"
+    "stepProgram-twoBridges W18:B4 R18:0B W19:B4 R19:0B R18:0B R19:0B R18:0B R19:0B R18:0B R19:0B R18:0B R19:0B R18:0B R19:0B R18:0A R19:0A W18:A5CC W19:A5CC R18:0B R19:0B R18:0B R19:0B R18:0A W18:A544 R19:0A W19:A544\n"
+    "recover R18:08 W18:E1D2 R18:B8 W18:B4 R18:0B*8 R18:0A\n"
+    "recover-deviceReset W18:E1F0 R18:18 W18:F0 R18:18 W18:D2F0 R18:00 W18:C3C3 R18:A3 W18:B4 R18:0B*8 R18:0A\n"
+    "recover-busClear R18:! W18:F0! C W18:F0 R18:18 W18:D2F0 R18:00 W18:B4 R18:0B*8 R18:0A\n";
+
+// Both simulated bridges on one bus, as on a shared I2C bus
+struct SharedBus : DS2482Bus {
+    DS2482Sim& first;
+    DS2482Sim& second;
+
+    SharedBus(DS2482Sim& first, DS2482Sim& second) :
+        first(first),
+        second(second) {}
+
+    void begin() override {}
+    uint8_t write(uint8_t address, const uint8_t* data, uint8_t length) override {
+        return bridge(address).write(address, data, length);
+    }
+    uint8_t read(uint8_t address, uint8_t* data, uint8_t length) override {
+        return bridge(address).read(address, data, length);
+    }
+    bool clearBus() override {
+        bool held = first.clearBus();
+        return second.clearBus() || held;
+    }
+    DS2482Sim& bridge(uint8_t address) {
+        return address == 0x19 ? second : first;
+    }
+};
+
+DS2482VirtualClock virtualClock;
+DS2482Sim sim(0x18, &virtualClock);
+DS2482Sim secondSim(0x19, &virtualClock);
+SharedBus bus(sim, secondSim);
+DS2482TraceBus trace(bus);
+DS2482 second(0x19, &trace, &virtualClock);    // Second bridge driver, begun by setup
+
+char text[TRACE_SIZE];
+
+// A public call and the state it starts from
+struct Operation {
+    const char* name;
+    bool begun;                         // Driver initialized with begin() first
+    void (*setup)(DS2482& ds2482);      // Further setup, not traced; may be nullptr
+    void (*run)(DS2482& ds2482);        // The traced call
+};
+
+void convertOnBothBridges(DS2482& ds2482);
+
+const Operation OPERATIONS[] = {
+    {"begin", false, nullptr, [](DS2482& d) { d.begin(); }},
+    {"reset", true, nullptr, [](DS2482& d) { d.reset(); }},
+    {"wakeUp", true, nullptr, [](DS2482& d) { d.wakeUp(); }},
+    {"warmStart", true, nullptr, [](DS2482& d) { d.warmStart(); }},
+    {"warmStart-powerUp", true, [](DS2482&) { sim.powerCycle(); }, [](DS2482& d) { d.warmStart(); }},
+    {"warmStart-cold", false, nullptr, [](DS2482& d) { d.warmStart(); }},
+    {"readStatus", true, [](DS2482& d) { d.selectChannel(1); }, [](DS2482& d) { d.readStatus(); }},
+    {"readStatus-again", true, [](DS2482& d) { d.readStatus(); }, [](DS2482& d) { d.readStatus(); }},
+    {"selectChannel", true, nullptr, [](DS2482& d) { d.selectChannel(3); }},
+    {"selectChannel-same", true, [](DS2482& d) { d.selectChannel(3); }, [](DS2482& d) { d.selectChannel(3); }},
+    {"writeConfig", true, nullptr, [](DS2482& d) { d.writeConfig(DS2482_CONFIG_APU); }},
+    {"writeConfig-same", true, [](DS2482& d) { d.writeConfig(DS2482_CONFIG_APU); }, [](DS2482& d) { d.writeConfig(DS2482_CONFIG_APU); }},
+    {"wireReset", true, nullptr, [](DS2482& d) { d.wireReset(); }},
+    {"wireReset-empty", true, [](DS2482& d) { d.selectChannel(1); }, [](DS2482& d) { d.wireReset(); }},
+    {"startWireReset", true, nullptr, [](DS2482& d) { d.startWireReset(); d.waitFor1Wire(); }},
+    {"wireWriteBit", true, nullptr, [](DS2482& d) { d.wireWriteBit(1); }},
+    {"wireReadBit", true, nullptr, [](DS2482& d) { d.wireReadBit(); }},
+    {"wireWriteByte", true, nullptr, [](DS2482& d) { d.wireWriteByte(0xCC); }},
+    {"wireReadByte", true, nullptr, [](DS2482& d) { d.wireReadByte(); }},
+    {"startTemperatureConversion", true, nullptr, [](DS2482& d) { d.startTemperatureConversion(0); }},
+    {"checkConversionStatus", true, [](DS2482& d) { d.startTemperatureConversion(0); virtualClock.advance(800000UL); },
+        [](DS2482& d) { d.checkConversionStatus(); d.checkConversionStatus(0); }},
+    {"readScratchpad", true, nullptr, [](DS2482& d) { uint8_t scratchpad[9]; d.readScratchpad(scratchpad); }},
+    {"readTemperatureRaw", true, [](DS2482& d) { d.startTemperatureConversion(0); virtualClock.advance(800000UL); },
+        [](DS2482& d) { int16_t raw; d.readTemperatureRaw(0, &raw); }},
+    {"readTemperature", true, [](DS2482& d) { d.startTemperatureConversion(3); virtualClock.advance(800000UL); },
+        [](DS2482& d) { float temperature; d.readTemperature(3, &temperature); }},
+    {"runProgram-convert", true, nullptr, [](DS2482& d) { d.runProgram(DS2482_PROGRAM_CONVERT, 0); }},
+    {"runProgram-noPresence", true, nullptr,
+        [](DS2482& d) { uint8_t scratchpad[9]; d.runProgram(DS2482_PROGRAM_READ_TEMPERATURE, 1, scratchpad); }},
+    {"stepProgram-twoBridges", true, [](DS2482&) { second.clearState(); second.begin(); }, convertOnBothBridges},
+    {"recover", true, nullptr, [](DS2482& d) { d.recover(); }},
+    {"recover-deviceReset", true, [](DS2482& d) { d.selectChannel(3); sim.powerCycle(); }, [](DS2482& d) { d.recover(); }},
+    {"recover-busClear", true, [](DS2482&) { sim.holdBus(); }, [](DS2482& d) { d.recover(); }},
+};
+const uint8_t OPERATION_COUNT = sizeof(OPERATIONS) / sizeof(OPERATIONS[0]);
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Golden Trace Test");
+    Serial.println("Call\t\t\t\tTransactions\tGolden\tDelta");
+
+    sim.setI2CClock(400000);
+    sim.attachSensor(0, 21.5 * 16, 12);
+    sim.attachSensor(3, -10 * 16, 9);
+    secondSim.setI2CClock(400000);
+    secondSim.attachSensor(0, 25 * 16, 12);
+
+    uint8_t differences = 0;
+    int32_t delta = 0;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < OPERATION_COUNT; i++) {
+        const Operation& operation = OPERATIONS[i];
+        runOperation(operation);
+
+        uint16_t golden = findGolden(operation.name);
+        bool found = golden != NO_GOLDEN;
+        uint32_t transactions = trace.getStats().transactions;
+        uint32_t expected = found ? goldenTransactions(golden) : 0;
+        bool same = found && !trace.isTruncated() && text[firstDifference(golden)] == '\0' &&
+                    goldenChar(golden + strlen(text)) == '\0';
+        total += transactions;
+        delta += (int32_t)transactions - (int32_t)expected;
+
+        Serial.print(operation.name);
+        for (uint8_t tabs = strlen(operation.name) / 8; tabs < 4; tabs++) {
+            Serial.print("\t");
+        }
+        Serial.print(transactions);
+        Serial.print("\t\t");
+        if (found) {
+            Serial.print(expected);
+        } else {
+            Serial.print("-");
+        }
+        Serial.print("\t");
+        printDelta((int32_t)transactions - (int32_t)expected);
+        Serial.println(same ? "" : "\tDIFFERS");
+
+        if (!same) {
+            differences++;
+            printDifference(operation.name, golden);
+        }
+    }
+
+    Serial.print("Total transactions: ");
+    Serial.print(total);
+    Serial.print(" (");
+    printDelta(delta);
+    Serial.println(" against golden)");
+    Serial.print("Calls that differ: ");
+    Serial.println(differences);
+    Serial.println(differences ? "FAILED" : "PASSED");
+}
+
+void loop() {
+}
+
+/**
+ * Bring bridge, clock and a fresh driver to the call's starting state, then
+ * trace the call
+ */
+void runOperation(const Operation& operation) {
+    virtualClock.set(0);
+    bus.clearBus();
+    sim.powerCycle();
+    secondSim.powerCycle();
+    trace.attachBuffer(nullptr, 0);
+
+    DS2482 ds2482(0x18, &trace, &virtualClock);
+    if (operation.begun) {
+        ds2482.begin();
+    }
+    if (operation.setup) {
+        operation.setup(ds2482);
+    }
+
+    trace.attachBuffer(text, sizeof(text));
+    operation.run(ds2482);
+}
+
+/**
+ * Start Convert T on channel 0 of both bridges and step the two programs in
+ * turns, polling every DS2482_POLL_INTERVAL_US, until both have ended
+ */
+void convertOnBothBridges(DS2482& ds2482) {
+    DS2482Program first, other;
+    ds2482.startProgram(first, DS2482_PROGRAM_CONVERT, 0);
+    second.startProgram(other, DS2482_PROGRAM_CONVERT, 0);
+
+    bool runningFirst = true, runningOther = true;
+    while (runningFirst || runningOther) {
+        runningFirst = runningFirst && ds2482.stepProgram(first) == DS2482ProgramStatus::RUNNING;
+        runningOther = runningOther && second.stepProgram(other) == DS2482ProgramStatus::RUNNING;
+        virtualClock.delayMicroseconds(DS2482_POLL_INTERVAL_US);
+    }
+}
+
+/**
+ * Find the golden trace of a call in GOLDEN
+ * The golden trace stays in flash; goldenChar() reads it.
+ * @return Offset of the trace in GOLDEN, NO_GOLDEN if there is no line for the call
+ */
+uint16_t findGolden(const char* name) {
+    uint16_t nameLength = strlen(name);
+    uint16_t i = 0;
+    while (pgm_read_byte(&GOLDEN[i])) {
+        uint16_t start = i;
+        while (goldenChar(i) && goldenChar(i) != ' ') {
+            i++;
+        }
+        bool match = i - start == nameLength;
+        for (uint16_t k = 0; match && k < nameLength; k++) {
+            match = goldenChar(start + k) == name[k];
+        }
+        if (goldenChar(i) == ' ') {
+            i++;
+        }
+        if (match) {
+            return i;
+        }
+
+        while (goldenChar(i)) {
+            i++;
+        }
+        if (pgm_read_byte(&GOLDEN[i]) == '\n') {
+            i++;
+        }
+    }
+    return NO_GOLDEN;
+}
+
+/**
+ * Character of GOLDEN, with the end of a line read as the end of the text
+ */
+char goldenChar(uint16_t at) {
+    char c = pgm_read_byte(&GOLDEN[at]);
+    return c == '\n' ? '\0' : c;
+}
+
+/**
+ * Position of the first character where the trace and a golden trace differ
+ * @return Length of the common start
+ */
+uint16_t firstDifference(uint16_t golden) {
+    uint16_t i = 0;
+    while (text[i] && text[i] == goldenChar(golden + i)) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Transactions of a golden trace, counted a token at a time
+ */
+uint32_t goldenTransactions(uint16_t golden) {
+    uint32_t count = 0;
+    char token[24];
+    uint8_t length = 0;
+    for (uint16_t i = golden; ; i++) {
+        char c = goldenChar(i);
+        if (c && c != ' ') {
+            if (length < sizeof(token) - 1) {
+                token[length++] = c;
+            }
+            continue;
+        }
+        token[length] = '\0';
+        count += DS2482TraceBus::countTransactions(token);
+        length = 0;
+        if (!c) {
+            return count;
+        }
+    }
+}
+
+/**
+ * Show where a trace left its golden trace, and the line to update it with
+ */
+void printDifference(const char* name, uint16_t golden) {
+    if (trace.isTruncated()) {
+        Serial.println("  Trace truncated, raise TRACE_SIZE");
+    }
+    if (golden != NO_GOLDEN) {
+        uint16_t difference = firstDifference(golden);
+        uint16_t token = 1;
+        for (uint16_t i = 0; i < difference; i++) {
+            token += text[i] == ' ';
+        }
+        Serial.print("  First difference in token ");
+        Serial.println(token);
+        Serial.print("  Golden: ");
+        for (uint16_t i = golden; goldenChar(i); i++) {
+            Serial.print(goldenChar(i));
+        }
+        Serial.println();
+        Serial.print("  Now:    ");
+        Serial.println(text);
+    }
+    Serial.print("  Update: \"");
+    Serial.print(name);
+    if (text[0]) {
+        Serial.print(" ");
+        Serial.print(text);
+    }
+    Serial.println("\\n\"");
+}
+
+/**
+ * Print a transaction delta with its sign
+ */
+void printDelta(int32_t delta) {
+    if (delta > 0) {
+        Serial.print("+");
+    }
+    Serial.print(delta);
+}
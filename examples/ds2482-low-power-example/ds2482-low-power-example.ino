@@ -0,0 +1,129 @@
+/*
+ * APADevices - DS2482 Low Power Example
+ *
+ * This example shows the wake cycle of a battery node that wakes, takes
+ * one reading and sleeps again:
+ * - The first wake runs begin(); every later one resumes with warmStart(),
+ *   which checks the bridge with a single status read instead of a device
+ *   reset, configuration write, wake-up read and status check
+ * - The driver state is saved with getShadow() before sleeping, in memory
+ *   that survives deep sleep (RTC memory on ESP32)
+ * - Every wake prints the start path, the time from wake to Convert T, the
+ *   I2C transactions until the reading was in, the charge the bridge and
+ *   sensor drew for it (energy accounting) and the temperature
+ *
+ * The sleep itself is board specific; delay() stands in for it here. If
+ * the bridge is powered down with the board, warmStart() notices the fresh
+ * bridge and only writes the configuration again.
+ *
+ * Hardware Setup:
+ * - Connect DS2482-800 to Arduino via I2C (SDA, SCL, VCC, GND)
+ * - Connect a DS18B20 to channel 0 with a 4.7kΩ pullup resistor
+ *
+ * Set USE_SIMULATOR to 1 to run the sketch without hardware against the
+ * simulated bridge; it powers the bridge down every POWER_DOWN_EVERY wakes.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+
+#define USE_SIMULATOR 0
+
+#if USE_SIMULATOR
+#include "DS2482Sim.h"
+DS2482Sim sim;
+DS2482 ds2482(0x18, &sim);
+#else
+DS2482 ds2482;
+#endif
+
+// Memory kept through deep sleep
+#if defined(ESP32)
+#define RETAINED RTC_DATA_ATTR
+#else
+#define RETAINED
+#endif
+
+RETAINED DS2482Shadow shadow;       // Zeroed on a cold boot: not valid
+RETAINED uint32_t wakes = 0;
+
+const uint8_t CHANNEL = 0;
+const unsigned long SLEEP_MS = 5000;
+const uint8_t POWER_DOWN_EVERY = 4;     // Simulated bridge power loss
+
+DS2482Energy energy[8];
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Low Power Example");
+    Serial.println("Wake\tStart\t\tTo Convert T us\tTransactions\tnAh\tTemperature");
+
+#if USE_SIMULATOR
+    sim.attachSensor(CHANNEL, 21 * 16, 9);
+    sim.setI2CClock(100000);        // Charge real transfer times
+#endif
+    ds2482.setConversionTime(94);   // DS18B20 at 9-bit resolution
+    ds2482.attachEnergy(energy);
+}
+
+void loop() {
+    wakeAndSample();
+
+    // Everything the next wake needs, taken after the last bus access
+    shadow = ds2482.getShadow();
+    wakes++;
+
+#if USE_SIMULATOR
+    if (wakes % POWER_DOWN_EVERY == 0) {
+        sim.powerCycle();
+    }
+#endif
+    delay(SLEEP_MS);    // Replace with the board's deep sleep call
+}
+
+/**
+ * Resume the bridge, take one reading and print what it cost
+ */
+void wakeAndSample() {
+    uint32_t wake = micros();
+    ds2482.resetBusStats();
+    ds2482.resetEnergy();
+
+    DS2482Start path = ds2482.warmStart(shadow);
+    if (path == DS2482Start::FAILED) {
+        Serial.println("Failed to initialize DS2482!");
+        return;
+    }
+
+    if (!ds2482.startTemperatureConversion(CHANNEL)) {
+        Serial.println("Conversion failed");
+        return;
+    }
+    uint32_t toConvert = ds2482.getConversionStartMicros() - wake;
+
+    // The board could sleep through the conversion as well
+    while (!ds2482.checkConversionStatus());
+
+    float temperature;
+    bool ok = ds2482.readTemperature(CHANNEL, &temperature);
+
+    static const char* const names[] = {"warm", "power-up", "begin()", "failed"};
+    Serial.print(wakes);
+    Serial.print("\t");
+    Serial.print(names[(uint8_t)path]);
+    Serial.print("\t\t");
+    Serial.print(toConvert);
+    Serial.print("\t\t");
+    Serial.print(ds2482.getBusStats().transactions);
+    Serial.print("\t\t");
+    Serial.print(ds2482.getEnergy(CHANNEL)->chargeNanoAh(ds2482.getCurrents()));
+    Serial.print("\t");
+    if (ok) {
+        Serial.print(temperature);
+        Serial.println(" °C");
+    } else {
+        Serial.println("read failed");
+    }
+}
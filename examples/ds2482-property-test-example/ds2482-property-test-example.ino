@@ -0,0 +1,292 @@
+/*
+ * APADevices - DS2482 Property Test
+ *
+ * This sketch drives the driver with random sequences of public API calls
+ * against the simulated bridge, with injected faults, and checks after every
+ * call that:
+ * - No call takes longer than its deadline (setCallTimeout()) plus MAX_OVERRUN_MS
+ * - The driver's shadow of the bridge matches the bridge: getCurrentChannel()
+ *   and getReadPointer() are either unknown or what the bridge really has,
+ *   and with isConfigApplied() the configuration is in place and RST clear
+ * - The driver is never wedged: once faults stop, clearState() followed by
+ *   a conversion and a read always succeeds
+ * - A sensor read before its conversion time has passed still returns the
+ *   85 °C power-on scratchpad, so conversion timing is simulated at all
+ *
+ * Every case is reproducible from its seed. A violation prints the seed, the
+ * call number and the sequence of calls leading to it; set FIRST_SEED to
+ * that seed and CASES to 1 to replay it. Run the sketch after any change to
+ * the driver's hot paths.
+ *
+ * Everything runs on a virtual clock, so the cases take as long as the host
+ * needs to execute them rather than the time a real bus would, and a seed
+ * replays with exactly the same timing.
+ *
+ * Runs on any board; no hardware is needed.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sim.h"
+#include "DS2482FaultBus.h"
+#include "DS2482Clock.h"
+
+const uint32_t FIRST_SEED = 1;
+const uint32_t CASES = 200;             // Random sequences to run
+const uint16_t CALLS_PER_CASE = 200;    // API calls per sequence
+const uint16_t PROBE_EVERY = 50;        // Calls between wedge checks
+const uint16_t CALL_TIMEOUT_MS = 30;    // Driver call deadline under test
+const unsigned long MAX_OVERRUN_MS = 5; // Settle delays and the transaction in flight
+const uint8_t HISTORY = 8;              // Calls shown with a violation
+
+DS2482VirtualClock virtualClock;
+DS2482Sim sim(0x18, &virtualClock);
+DS2482FaultBus faults(sim, 1, &virtualClock);
+DS2482 ds2482(0x18, &faults, &virtualClock);
+
+uint32_t rng;
+uint8_t history[HISTORY];
+uint16_t historyCount;
+bool shadowKnown;       // False after a power cycle until the driver resynchronises
+uint16_t resets;         // Device resets the driver noticed
+uint32_t violations = 0;
+unsigned long worstCall = 0;
+
+// API calls under test
+enum Call : uint8_t {
+    CALL_BEGIN, CALL_RESET, CALL_WAKE_UP, CALL_READ_STATUS, CALL_SELECT_CHANNEL,
+    CALL_WIRE_RESET, CALL_WRITE_BIT, CALL_READ_BIT, CALL_WRITE_BYTE, CALL_READ_BYTE,
+    CALL_START_CONVERSION, CALL_CHECK_CONVERSION, CALL_READ_TEMPERATURE, CALL_READ_SCRATCHPAD,
+    CALL_START_WIRE_RESET, CALL_WAIT_1WIRE, CALL_CLEAR_STATE, CALL_RECOVER, CALL_WARM_START, CALL_POWER_CYCLE,
+    CALL_COUNT
+};
+
+const char* const callNames[CALL_COUNT] = {
+    "begin", "reset", "wakeUp", "readStatus", "selectChannel",
+    "wireReset", "wireWriteBit", "wireReadBit", "wireWriteByte", "wireReadByte",
+    "startTemperatureConversion", "checkConversionStatus", "readTemperatureRaw", "readScratchpad",
+    "startWireReset", "waitFor1Wire", "clearState", "recover", "warmStart", "(power cycle)"
+};
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Property Test");
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        if (channel != 6) {   // Channel 6 stays empty: presence failures
+            sim.attachSensor(channel, (18 + channel) * 16, 9);
+        }
+    }
+    sim.setI2CClock(400000);       // Transactions advance the virtual clock
+    ds2482.setConversionTime(94);  // 9-bit conversions
+    ds2482.setCallTimeout(CALL_TIMEOUT_MS);
+
+    for (uint32_t seed = FIRST_SEED; seed < FIRST_SEED + CASES; seed++) {
+        runCase(seed);
+        if ((seed - FIRST_SEED + 1) % 20 == 0) {
+            Serial.print("Cases: ");
+            Serial.print(seed - FIRST_SEED + 1);
+            Serial.print("  violations: ");
+            Serial.print(violations);
+            Serial.print("  worst call ms: ");
+            Serial.print(worstCall);
+            Serial.print("  aborted calls: ");
+            Serial.println(ds2482.getAbortCount());
+        }
+    }
+
+    Serial.println(violations ? "FAILED" : "PASSED");
+}
+
+void loop() {
+}
+
+/**
+ * Run one random call sequence
+ */
+void runCase(uint32_t seed) {
+    rng = seed;
+    historyCount = 0;
+
+    faults.setEnabled(false);
+    sim.powerCycle();
+    ds2482.clearState();
+    if (!ds2482.begin()) {
+        report(seed, 0, "begin() failed without faults");
+        return;
+    }
+    shadowKnown = true;
+    resets = ds2482.getDeviceResetCount();
+    if (!checkEarlyRead(seed % 6)) {
+        report(seed, 0, "read before the conversion time did not return the power-on value");
+        return;
+    }
+
+    faults.setSeed(seed);
+    faults.setRate(DS2482Fault::NACK, nextRandom() % 200);
+    faults.setRate(DS2482Fault::CORRUPT_READ, nextRandom() % 200);
+    faults.setRate(DS2482Fault::HOLD_BUSY, nextRandom() % 20);
+    faults.setRate(DS2482Fault::CLEAR_PRESENCE, nextRandom() % 200);
+    faults.setHoldTime(1000 + nextRandom() % (2000UL * DS2482_TIMEOUT_MS));
+
+    for (uint16_t i = 1; i <= CALLS_PER_CASE; i++) {
+        faults.setEnabled(true);
+        uint8_t call = nextRandom() % CALL_COUNT;
+        history[historyCount++ % HISTORY] = call;
+
+        unsigned long start = virtualClock.millis();
+        runCall(call);
+        unsigned long elapsed = virtualClock.millis() - start;
+        faults.setEnabled(false);
+
+        if (elapsed > worstCall) {
+            worstCall = elapsed;
+        }
+        if (elapsed > CALL_TIMEOUT_MS + MAX_OVERRUN_MS) {
+            report(seed, i, "call overran its deadline");
+        }
+
+        if (ds2482.getDeviceResetCount() != resets) {
+            resets = ds2482.getDeviceResetCount();
+            shadowKnown = true;     // Driver noticed the power cycle
+        }
+        if (shadowKnown) {
+            checkShadow(seed, i);
+        }
+
+        if (i % PROBE_EVERY == 0 && !probe()) {
+            report(seed, i, "driver wedged: no reading after clearState()");
+        }
+    }
+}
+
+/**
+ * Execute one API call with random arguments
+ */
+void runCall(uint8_t call) {
+    uint8_t channel = nextRandom() % 9;   // 8 is invalid on purpose
+    uint8_t scratchpad[9];
+    int16_t raw;
+
+    switch (call) {
+        case CALL_BEGIN:             shadowKnown |= ds2482.begin(); break;
+        case CALL_RESET:             shadowKnown |= ds2482.reset(); break;
+        case CALL_WAKE_UP:           ds2482.wakeUp(); break;
+        case CALL_READ_STATUS:       ds2482.readStatus(); break;
+        case CALL_SELECT_CHANNEL:    ds2482.selectChannel(channel); break;
+        case CALL_WIRE_RESET:        ds2482.wireReset(); break;
+        case CALL_WRITE_BIT:         ds2482.wireWriteBit(nextRandom() & 1); break;
+        case CALL_READ_BIT:          ds2482.wireReadBit(); break;
+        case CALL_WRITE_BYTE:        ds2482.wireWriteByte(nextRandom() & 0xFF); break;
+        case CALL_READ_BYTE:         ds2482.wireReadByte(); break;
+        case CALL_START_CONVERSION:  ds2482.startTemperatureConversion(channel); break;
+        case CALL_CHECK_CONVERSION:  ds2482.checkConversionStatus(); break;
+        case CALL_READ_TEMPERATURE:  ds2482.readTemperatureRaw(channel, &raw); break;
+        case CALL_READ_SCRATCHPAD:   ds2482.readScratchpad(scratchpad); break;
+        case CALL_START_WIRE_RESET:  ds2482.startWireReset(); break;
+        case CALL_WAIT_1WIRE:        ds2482.waitFor1Wire(); break;
+        case CALL_CLEAR_STATE:       ds2482.clearState(); break;
+        case CALL_RECOVER:           shadowKnown |= ds2482.recover() != DS2482Recovery::FAILED; break;
+        case CALL_WARM_START:        shadowKnown |= ds2482.warmStart() != DS2482Start::FAILED; break;
+        case CALL_POWER_CYCLE:
+            sim.powerCycle();
+            shadowKnown = false;
+            break;
+    }
+}
+
+/**
+ * Compare the driver's shadow with the simulated bridge
+ */
+void checkShadow(uint32_t seed, uint16_t call) {
+    uint8_t channel = ds2482.getCurrentChannel();
+    if (channel != DS2482_CHANNEL_UNKNOWN && channel != sim.getChannel()) {
+        report(seed, call, "getCurrentChannel() differs from the bridge");
+        shadowKnown = false;
+        return;
+    }
+
+    uint8_t pointer = ds2482.getReadPointer();
+    if (pointer != DS2482_REG_UNKNOWN && pointer != sim.getReadPointer()) {
+        report(seed, call, "getReadPointer() differs from the bridge");
+        shadowKnown = false;
+        return;
+    }
+
+    if (ds2482.isConfigApplied() &&
+        (sim.getConfig() != ds2482.getConfig() || (sim.getStatus() & DS2482_STATUS_RST))) {
+        report(seed, call, "configuration not applied although isConfigApplied()");
+        shadowKnown = false;
+    }
+}
+
+/**
+ * Check that the driver can still take a reading once faults stop
+ * @return true if a conversion and a read succeeded
+ */
+bool probe() {
+    ds2482.clearState();
+    uint8_t channel = nextRandom() % 6;
+    if (!ds2482.startTemperatureConversion(channel)) {
+        return false;
+    }
+    unsigned long start = virtualClock.millis();
+    while (!ds2482.checkConversionStatus()) {
+        if (virtualClock.millis() - start > 2 * DS2482_CONVERSION_TIME_MS) {
+            return false;
+        }
+        virtualClock.advance(1000);    // Nothing else moves virtual time here
+    }
+    int16_t raw;
+    bool ok = ds2482.readTemperatureRaw(channel, &raw);
+    shadowKnown = true;
+    resets = ds2482.getDeviceResetCount();   // Resets the probe noticed are not news
+    return ok && raw == (18 + channel) * 16;
+}
+
+/**
+ * Read a freshly powered sensor right after Convert T
+ * @param channel Channel with a sensor
+ * @return true if the read was refused as DS2482Frame::POWER_ON_RESET
+ */
+bool checkEarlyRead(uint8_t channel) {
+    if (!ds2482.startTemperatureConversion(channel)) {
+        return false;
+    }
+    int16_t raw;
+    bool ok = ds2482.readTemperatureRaw(channel, &raw);
+    return !ok && ds2482.getLastFrame() == DS2482Frame::POWER_ON_RESET && raw == DS2482_RAW_POWER_ON;
+}
+
+/**
+ * Print a violation with everything needed to replay it
+ */
+void report(uint32_t seed, uint16_t call, const char* message) {
+    violations++;
+    Serial.print("VIOLATION seed ");
+    Serial.print(seed);
+    Serial.print(" call ");
+    Serial.print(call);
+    Serial.print(": ");
+    Serial.println(message);
+
+    Serial.print("  last calls:");
+    uint16_t first = historyCount > HISTORY ? historyCount - HISTORY : 0;
+    for (uint16_t i = first; i < historyCount; i++) {
+        Serial.print(" ");
+        Serial.print(callNames[history[i % HISTORY]]);
+    }
+    Serial.println();
+}
+
+/**
+ * xorshift32, identical on every platform so seeds replay anywhere
+ */
+uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
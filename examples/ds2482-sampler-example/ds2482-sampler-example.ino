@@ -0,0 +1,136 @@
+/*
+ * APADevices - DS2482 Sampling Engine Example
+ *
+ * This example shows the DS2482Sampler engine, which runs the
+ * convert / wait / read cycle for all channels without blocking loop():
+ * - Samples every channel once per sweep, one sweep every 5 seconds
+ * - Filters each sensor in fixed point: drops 85 °C / -127 °C readings,
+ *   rejects single-sample spikes with a 3-tap median, smooths with an EMA
+ * - Reports a sample only when it changed by 0.25 °C or more, or after
+ *   one minute without a report (heartbeat)
+ * - Keeps running statistics per sensor (count, min, max, mean, variance)
+ *   without storing any sample history
+ * - Accounts the charge each sensor costs (I2C, 1-Wire and conversion time
+ *   at typical currents), per sample and per sweep
+ * - Prints a summary every 30 seconds, as an uplink would send it
+ *
+ * Hardware Setup:
+ * - Connect DS2482-800 to Arduino via I2C (SDA, SCL, VCC, GND)
+ * - Connect one DS18B20 per channel, each with a 4.7kΩ pullup resistor
+ *
+ * Set USE_SIMULATOR to 1 to run the sketch without hardware against the
+ * simulated bridge.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sampler.h"
+
+#define USE_SIMULATOR 0
+
+#if USE_SIMULATOR
+#include "DS2482Sim.h"
+DS2482Sim sim;
+DS2482 ds2482(0x18, &sim);
+#else
+DS2482 ds2482;
+#endif
+
+DS2482Sampler sampler(ds2482);
+DS2482SensorStats sensorStats[8];
+DS2482Filter sensorFilters[8];
+DS2482Report sensorReports[8];
+DS2482Energy sensorEnergy[8];
+
+const unsigned long SWEEP_INTERVAL = 5000;     // Start a sweep every 5 seconds
+const unsigned long SUMMARY_INTERVAL = 30000;  // Print statistics every 30 seconds
+
+unsigned long lastSummary = 0;
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Sampling Engine Example");
+
+#if USE_SIMULATOR
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        sim.attachSensor(channel, (18 + channel) * 16);
+    }
+#endif
+
+    if (!ds2482.begin()) {
+        Serial.println("Failed to initialize DS2482!");
+        while (1);
+    }
+
+    sampler.setChannels(0xFF);  // All 8 channels
+    sampler.setInterval(SWEEP_INTERVAL);
+    sampler.attachStats(sensorStats);
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        // Reject invalid values, 3-tap median, alpha = 1/4, at most 2 °C per sample
+        sensorFilters[channel].configure(true, 3, 2, 2 * 16);
+    }
+    sampler.attachFilters(sensorFilters);
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        sensorReports[channel].configure(4, 60000);  // 4/16 °C deadband, 60 s heartbeat
+    }
+    sampler.attachReports(sensorReports);
+
+    ds2482.attachEnergy(sensorEnergy);
+}
+
+void loop() {
+    DS2482Sample sample;
+    if (sampler.update(&sample)) {
+        Serial.print("Channel ");
+        Serial.print(sample.channel);
+        Serial.print(": ");
+        Serial.print(sample.celsius());
+        Serial.println(" °C");
+    }
+
+    if (millis() - lastSummary >= SUMMARY_INTERVAL) {
+        lastSummary = millis();
+        printSummary();
+        sampler.resetStats();
+        ds2482.resetEnergy();
+    }
+
+    // Other work can run here - the sampler never blocks for a conversion
+}
+
+/**
+ * Print the statistics accumulated since the last summary
+ */
+void printSummary() {
+    Serial.println("\nCh\tCount\tMin\tMax\tMean\tVariance\tErrors\tnAh/sample");
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        const DS2482SensorStats* stats = sampler.getStats(channel);
+        Serial.print(channel);
+        Serial.print("\t");
+        Serial.print(stats->count);
+        if (stats->count > 0) {
+            Serial.print("\t");
+            Serial.print(stats->minRaw / 16.0);
+            Serial.print("\t");
+            Serial.print(stats->maxRaw / 16.0);
+            Serial.print("\t");
+            Serial.print(stats->meanCelsius());
+            Serial.print("\t");
+            Serial.print(stats->varianceCelsius(), 4);
+        } else {
+            Serial.print("\t-\t-\t-\t-");
+        }
+        Serial.print("\t\t");
+        Serial.print(sampler.getErrorCount(channel));
+        Serial.print("\t");
+        Serial.println(ds2482.getEnergy(channel)->perSampleNanoAh(ds2482.getCurrents()));
+    }
+    Serial.print("Charge per sweep: ");
+    Serial.print(ds2482.perSweepNanoAh());
+    Serial.println(" nAh");
+    Serial.println();
+}
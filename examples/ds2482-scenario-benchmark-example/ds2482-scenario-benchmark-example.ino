@@ -0,0 +1,299 @@
+/*
+ * APADevices - DS2482 Scenario Benchmark
+ *
+ * This sketch benchmarks the sampling engine on many deployment shapes
+ * without rebuilding: each shape is a text scenario (see DS2482Scenario.h)
+ * with bridges, sensors, temperature waveforms and fault windows.
+ * - The built-in scenarios below are streamed through DS2482ScenarioReader
+ *   from flash; more can be pasted into the serial monitor afterwards
+ * - Every scenario runs for its duration (DEFAULT_DURATION_S if none is
+ *   given) in virtual time, one DS2482Sampler per bridge, all on one clock
+ *   so the bridges share the I2C bus as they would in the field
+ * - Per bridge it prints samples per hour, the mean sweep time next to the
+ *   DS2482CostModel prediction, the injected faults, the recover() calls
+ *   and how far the readings lagged the waveform at worst
+ *
+ * The driver waits the same conversion time for every sensor of a bridge,
+ * the longest one of its population, and so does the model.
+ *
+ * A scenario with an error is reported with its line number and skipped.
+ *
+ * Runs on any board; no hardware is needed. A host build runs the built-in
+ * set in a few seconds.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sampler.h"
+#include "DS2482Sim.h"
+#include "DS2482FaultBus.h"
+#include "DS2482CostModel.h"
+#include "DS2482Clock.h"
+#include "DS2482Scenario.h"
+
+const uint32_t DEFAULT_DURATION_S = 600;
+const uint8_t RECOVER_AFTER = 8;        // Failed channels in a row before recover()
+
+const char SCENARIOS[] PROGMEM =
+    "# One probe, the simplest deployment\n"
+    "scenario single\n"
+    "bridge 0x18\n"
+    "sensor 0 DS18B20 12 temp 21.5\n"
+    "end\n"
+    "\n"
+    "# Full bridge at 12 and at 9 bits\n"
+    "scenario full-12bit\n"
+    "bridge 0x18\n"
+    "sensor 0 DS18B20 12 sine 18 24 3600\n"
+    "sensor 1 DS18B20 12 sine 18 24 3600\n"
+    "sensor 2 DS18B20 12 sine 18 24 3600\n"
+    "sensor 3 DS18B20 12 sine 18 24 3600\n"
+    "sensor 4 DS18B20 12 sine 18 24 3600\n"
+    "sensor 5 DS18B20 12 sine 18 24 3600\n"
+    "sensor 6 DS18B20 12 sine 18 24 3600\n"
+    "sensor 7 DS18B20 12 sine 18 24 3600\n"
+    "end\n"
+    "scenario full-9bit\n"
+    "i2c 400000\n"
+    "bridge 0x18\n"
+    "sensor 0 DS18B20 9 sine 18 24 3600\n"
+    "sensor 1 DS18B20 9 sine 18 24 3600\n"
+    "sensor 2 DS18B20 9 sine 18 24 3600\n"
+    "sensor 3 DS18B20 9 sine 18 24 3600\n"
+    "sensor 4 DS18B20 9 sine 18 24 3600\n"
+    "sensor 5 DS18B20 9 sine 18 24 3600\n"
+    "sensor 6 DS18B20 9 sine 18 24 3600\n"
+    "sensor 7 DS18B20 9 sine 18 24 3600\n"
+    "end\n"
+    "\n"
+    "# One fast probe among slow ones\n"
+    "scenario mixed-res\n"
+    "i2c 400000\n"
+    "bridge 0x18\n"
+    "sensor 0 DS18B20 9 square 20 60 120\n"
+    "sensor 1 DS1822 12 rom 22-10-00-00-00-00-01 temp 25\n"
+    "sensor 2 DS18B20 11 temp 25\n"
+    "end\n"
+    "\n"
+    "# Four bridges sharing one bus\n"
+    "scenario four-bridges\n"
+    "i2c 400000\n"
+    "bridge 0x18\n"
+    "sensor 0 DS18B20 10 ramp 10 30 600\n"
+    "sensor 1 DS18B20 10 ramp 10 30 600\n"
+    "sensor 2 DS18B20 10 ramp 10 30 600\n"
+    "bridge 0x19\n"
+    "sensor 0 DS18B20 10 temp 4\n"
+    "sensor 7 DS18B20 10 temp -18\n"
+    "bridge 0x1A\n"
+    "sensor 3 DS18B20 10 sine 60 90 300\n"
+    "bridge 0x1B\n"
+    "sensor 5 DS1822 10 temp 35\n"
+    "end\n"
+    "\n"
+    "# Long cable runs: presence and corruption faults, a stuck bus for a minute\n"
+    "scenario noisy-field\n"
+    "seed 99\n"
+    "bridge 0x18\n"
+    "sensor 0 DS18B20 12 sine 5 35 86400\n"
+    "sensor 1 DS18B20 12 sine 5 35 86400\n"
+    "sensor 2 DS18B20 12 sine 5 35 86400\n"
+    "sensor 3 DS18B20 12 sine 5 35 86400\n"
+    "fault presence 200\n"
+    "fault corrupt 100\n"
+    "fault stuck 20 from 300 until 360\n"
+    "end\n"
+    "\n"
+    "# Typo: reported and skipped\n"
+    "scenario broken\n"
+    "bridge 0x18\n"
+    "sensor 0 DS18B20 13\n"
+    "end\n";
+
+DS2482VirtualClock virtualClock;
+
+// Simulated bridge, fault injector, driver and sampler at one address
+struct Node {
+    DS2482Sim sim;
+    DS2482FaultBus faults;
+    DS2482 ds2482;
+    DS2482Sampler sampler;
+
+    Node(uint8_t address) :
+        sim(address, &virtualClock),
+        faults(sim, 1, &virtualClock),
+        ds2482(address, &faults, &virtualClock),
+        sampler(ds2482) {}
+};
+
+Node nodes[DS2482_SCENARIO_MAX_BRIDGES] = {{0x18}, {0x19}, {0x1A}, {0x1B}};
+
+// Results of one bridge in the current run
+struct BridgeRun {
+    uint32_t samples;
+    uint32_t sweeps;
+    uint8_t lastChannel;
+    uint16_t recoveries;
+    int16_t worstLag;           // Largest |reading - waveform| in 1/16 °C
+};
+
+DS2482Scenario scenario;
+DS2482ScenarioReader reader(scenario);
+BridgeRun runs[DS2482_SCENARIO_MAX_BRIDGES];
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Scenario Benchmark");
+    Serial.println("Scenario\t\tBridge\tSensors\tSamples/h\tSweep ms\tModel ms\tFaults\tRecoveries\tWorst lag °C");
+
+    for (uint16_t i = 0; i < sizeof(SCENARIOS) - 1; i++) {
+        handle(reader.feed(pgm_read_byte(&SCENARIOS[i])));
+    }
+    handle(reader.finish());
+    reader.reset();
+    Serial.println("Paste more scenarios to run them");
+}
+
+void loop() {
+    while (Serial.available()) {
+        handle(reader.feed(Serial.read()));
+    }
+}
+
+/**
+ * Run a completed scenario, or report a rejected line
+ */
+void handle(DS2482ScenarioStatus status) {
+    if (status == DS2482ScenarioStatus::READY) {
+        runScenario();
+    } else if (status == DS2482ScenarioStatus::ERROR) {
+        Serial.print("Line ");
+        Serial.print(reader.getErrorLine());
+        Serial.print(": ");
+        Serial.println(reader.getError());
+    }
+}
+
+/**
+ * Run the scenario in virtual time and print one line per bridge
+ */
+void runScenario() {
+    uint32_t duration = scenario.durationMs ? scenario.durationMs : DEFAULT_DURATION_S * 1000;
+
+    for (uint8_t b = 0; b < scenario.bridgeCount; b++) {
+        Node& node = nodes[scenario.bridges[b].address - 0x18];
+        node.faults.setEnabled(false);
+        node.sim.powerCycle();
+        scenario.apply(b, node.sim);
+
+        // One conversion time per bridge: the longest of its sensors
+        DS2482CostModel model;
+        scenario.applyModel(b, model);
+        node.ds2482.setConversionTime(model.getConversionTime());
+        node.ds2482.clearState();
+        node.ds2482.begin();
+
+        node.faults.setSeed(scenario.seed + b);
+        node.faults.resetCounters();
+        scenario.applyFaults(b, node.faults, 0);
+        node.faults.setEnabled(true);
+        node.sampler.setChannels(scenario.bridges[b].getChannels());
+        node.sampler.setMaxRetries(2);
+        node.sampler.resetFailureStreak();
+
+        runs[b].samples = 0;
+        runs[b].sweeps = 0;
+        runs[b].lastChannel = 8;
+        runs[b].recoveries = 0;
+        runs[b].worstLag = 0;
+    }
+
+    uint64_t start = virtualClock.getTime();
+    uint32_t elapsed = 0;
+    while (elapsed < duration) {
+        unsigned long sleep = DS2482_NEVER_MS;
+        for (uint8_t b = 0; b < scenario.bridgeCount; b++) {
+            step(b, elapsed);
+            Node& node = nodes[scenario.bridges[b].address - 0x18];
+            sleep = min(sleep, node.sampler.timeToNextEvent());
+        }
+        virtualClock.advance(min(sleep, 1000UL) * 1000);    // Waveforms and fault windows move at least every second
+        elapsed = (virtualClock.getTime() - start) / 1000;
+    }
+
+    for (uint8_t b = 0; b < scenario.bridgeCount; b++) {
+        Node& node = nodes[scenario.bridges[b].address - 0x18];
+        node.sampler.setChannels(0);
+        node.faults.setEnabled(false);
+        printBridge(b, node, duration);
+    }
+}
+
+/**
+ * Move one bridge's waveforms, faults and sampler along
+ * @param b Bridge index in the scenario
+ * @param elapsed ms since the start of the run
+ */
+void step(uint8_t b, uint32_t elapsed) {
+    Node& node = nodes[scenario.bridges[b].address - 0x18];
+    BridgeRun& run = runs[b];
+    scenario.update(b, node.sim, elapsed);
+    scenario.applyFaults(b, node.faults, elapsed);
+
+    DS2482Sample sample;
+    if (node.sampler.update(&sample)) {
+        run.samples++;
+        if (sample.channel <= run.lastChannel && run.lastChannel != 8) {
+            run.sweeps++;
+        }
+        run.lastChannel = sample.channel;
+
+        int16_t expected = scenario.bridges[b].sensors[sample.channel].temperatureAt(elapsed);
+        int16_t lag = abs(sample.raw - expected);
+        run.worstLag = max(run.worstLag, lag);
+    }
+
+    if (node.sampler.getFailureStreak() >= RECOVER_AFTER) {
+        node.ds2482.recover();
+        node.sampler.resetFailureStreak();
+        run.recoveries++;
+    }
+}
+
+/**
+ * Print the results of one bridge
+ */
+void printBridge(uint8_t b, Node& node, uint32_t duration) {
+    const BridgeRun& run = runs[b];
+    DS2482CostModel model;
+    scenario.applyModel(b, model);
+
+    uint8_t sensors = 0;
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        sensors += scenario.bridges[b].sensors[channel].present;
+    }
+
+    Serial.print(scenario.name);
+    Serial.print(strlen(scenario.name) < 8 ? "\t\t0x" : "\t0x");
+    Serial.print(scenario.bridges[b].address, HEX);
+    Serial.print("\t");
+    Serial.print(sensors);
+    Serial.print("\t");
+    Serial.print((uint32_t)((uint64_t)run.samples * 3600000 / duration));
+    Serial.print("\t\t");
+    if (run.sweeps) {
+        Serial.print(duration / run.sweeps);
+    } else {
+        Serial.print("-");
+    }
+    Serial.print("\t\t");
+    Serial.print(model.predictSweep().micros / 1000);
+    Serial.print("\t\t");
+    Serial.print(node.faults.getInjectedTotal());
+    Serial.print("\t");
+    Serial.print(run.recoveries);
+    Serial.print("\t\t");
+    Serial.println(run.worstLag / 16.0);
+}
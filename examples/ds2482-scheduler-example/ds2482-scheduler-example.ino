@@ -0,0 +1,118 @@
+/*
+ * APADevices - DS2482 Priority Scheduler Example
+ *
+ * This example samples sensors of different importance at different rates
+ * with DS2482Scheduler:
+ * - Channels 0-1: safety-critical (e.g. compressor discharge), class 0,
+ *   every second, result needed within 900 ms
+ * - Channels 2-3: control loop inputs, class 1, every 2 seconds
+ * - Channels 4-7: informational, class 2, every 10 seconds
+ * - Prints every sample and, every 30 seconds, the jobs completed and
+ *   deadline misses per sensor
+ * - Sleeps between operations until the next release or conversion
+ *   completion (nextEventAt()) instead of polling
+ *
+ * Critical conversions and reads always run before pending informational
+ * work, so the critical probes keep their deadlines even with all eight
+ * channels populated.
+ *
+ * Hardware Setup:
+ * - Connect DS2482-800 to Arduino via I2C (SDA, SCL, VCC, GND)
+ * - Connect one externally powered DS18B20 per channel, each with a 4.7kΩ
+ *   pullup resistor
+ *
+ * Set USE_SIMULATOR to 1 to run the sketch without hardware against the
+ * simulated bridge.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Scheduler.h"
+
+#define USE_SIMULATOR 0
+
+#if USE_SIMULATOR
+#include "DS2482Sim.h"
+DS2482Sim sim;
+DS2482 ds2482(0x18, &sim);
+#else
+DS2482 ds2482;
+#endif
+
+DS2482Scheduler scheduler(ds2482);
+
+const unsigned long SUMMARY_INTERVAL = 30000;
+
+unsigned long lastSummary = 0;
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Priority Scheduler Example");
+
+#if USE_SIMULATOR
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        sim.attachSensor(channel, (18 + channel) * 16);
+    }
+#endif
+
+    if (!ds2482.begin()) {
+        Serial.println("Failed to initialize DS2482!");
+        while (1);
+    }
+
+    scheduler.setSensor(0, 0, 1000, 900);
+    scheduler.setSensor(1, 0, 1000, 900);
+    scheduler.setSensor(2, 1, 2000);
+    scheduler.setSensor(3, 1, 2000);
+    for (uint8_t channel = 4; channel < 8; channel++) {
+        scheduler.setSensor(channel, 2, 10000);
+    }
+    lastSummary = millis();
+}
+
+void loop() {
+    DS2482Sample sample;
+    if (scheduler.update(&sample)) {
+        Serial.print("Channel ");
+        Serial.print(sample.channel);
+        Serial.print(": ");
+        Serial.print(sample.celsius());
+        Serial.println(" °C");
+    }
+
+    if (millis() - lastSummary >= SUMMARY_INTERVAL) {
+        lastSummary = millis();
+        printSummary();
+        scheduler.resetCounters();
+    }
+
+    // Nothing is ready before the next event; delay() stands in for the
+    // board's light sleep
+    unsigned long sinceSummary = millis() - lastSummary;
+    unsigned long toSummary = sinceSummary < SUMMARY_INTERVAL ? SUMMARY_INTERVAL - sinceSummary : 0;
+    delay(min(scheduler.timeToNextEvent(), toSummary));
+}
+
+/**
+ * Print completed jobs and deadline misses per sensor
+ */
+void printSummary() {
+    Serial.println("\nCh\tClass\tJobs\tMisses\tMax late ms\tErrors");
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        const DS2482Task* task = scheduler.getTask(channel);
+        Serial.print(channel);
+        Serial.print("\t");
+        Serial.print(task->priority);
+        Serial.print("\t");
+        Serial.print(task->completed);
+        Serial.print("\t");
+        Serial.print(task->misses);
+        Serial.print("\t");
+        Serial.print(task->maxLateness);
+        Serial.print("\t\t");
+        Serial.println(scheduler.getErrorCount(channel));
+    }
+    Serial.println();
+}
@@ -0,0 +1,106 @@
+/*
+ * APADevices - DS2482 Synchronised Snapshot Example
+ *
+ * This example samples every probe on two bridges at (nearly) the same
+ * moment, e.g. for thermal gradient measurements:
+ * - Triggers Skip ROM + Convert T on all channels of both bridges at once
+ * - Prints the skew between the first and the last conversion start
+ * - Reads the results once their conversions are done, printing each
+ *   probe's start offset relative to the first one
+ * - Repeats every 10 seconds
+ *
+ * Hardware Setup:
+ * - Connect two DS2482-800 to Arduino via I2C (SDA, SCL, VCC, GND),
+ *   addresses 0x18 and 0x19 (AD0 high on the second one)
+ * - Connect one DS18B20 per channel, each with a 4.7kΩ pullup resistor
+ * - Sensors must be externally powered (not parasite powered), since the
+ *   bridge moves on to the next channel while they convert
+ *
+ * Set USE_SIMULATOR to 1 to run the sketch without hardware against two
+ * simulated bridges.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Snapshot.h"
+
+#define USE_SIMULATOR 0
+
+#if USE_SIMULATOR
+#include "DS2482Sim.h"
+DS2482Sim simA(0x18);
+DS2482Sim simB(0x19);
+DS2482 ds2482a(0x18, &simA);
+DS2482 ds2482b(0x19, &simB);
+#else
+DS2482 ds2482a(0x18);
+DS2482 ds2482b(0x19);
+#endif
+
+DS2482SnapshotBridge bridges[2] = {
+    {&ds2482a, 0xFF, 0, 0, {}},     // All 8 channels; the rest is trigger()'s bookkeeping
+    {&ds2482b, 0xFF, 0, 0, {}}
+};
+DS2482Snapshot snapshot(bridges, 2);
+
+const unsigned long SNAPSHOT_INTERVAL = 10000;
+
+unsigned long lastSnapshot = 0;
+bool triggered = false;
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Synchronised Snapshot Example");
+
+#if USE_SIMULATOR
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        simA.attachSensor(channel, (20 * 16) + channel * 4);   // 20.00, 20.25, ... °C
+        simB.attachSensor(channel, (22 * 16) + channel * 4);
+    }
+#endif
+
+    if (!ds2482a.begin() || !ds2482b.begin()) {
+        Serial.println("Failed to initialize DS2482!");
+        while (1);
+    }
+}
+
+void loop() {
+    if (!triggered && (lastSnapshot == 0 || millis() - lastSnapshot >= SNAPSHOT_INTERVAL)) {
+        lastSnapshot = millis();
+        triggered = true;
+
+        snapshot.trigger();
+        Serial.print("\nSnapshot: ");
+        Serial.print(snapshot.getStartedCount());
+        Serial.print(" conversions started, skew ");
+        Serial.print(snapshot.getSkewMicros());
+        Serial.println(" us");
+    }
+
+    uint8_t bridge;
+    DS2482Sample sample;
+    while (snapshot.readNext(&bridge, &sample)) {
+        Serial.print("Bridge ");
+        Serial.print(bridge);
+        Serial.print(" ch");
+        Serial.print(sample.channel);
+        Serial.print(" +");
+        Serial.print(sample.startMicros - snapshot.getTriggerMicros());
+        Serial.print(" us: ");
+        Serial.print(sample.celsius());
+        Serial.println(" °C");
+    }
+
+    if (triggered && snapshot.isComplete()) {
+        triggered = false;
+        if (snapshot.getFailedCount()) {
+            Serial.print(snapshot.getFailedCount());
+            Serial.println(" channel(s) failed");
+        }
+    }
+
+    // Other work can run here while the sensors convert
+}
@@ -0,0 +1,402 @@
+/*
+ * APADevices - DS2482 Soak Test
+ *
+ * This sketch runs the sampling engine and the driver's public API for
+ * days of virtual time and checks that nothing drifts:
+ * - DS2482VirtualClock starts one day before millis() wraps at 49.7 days,
+ *   so the wrap happens mid-run; micros() wraps every 71.6 minutes
+ * - DS2482FaultBus injects NACKs, corrupted reads, stuck 1WB, missing
+ *   presence pulses and stuck buses; sensors drop off the bus and come back
+ *   at random, and their temperatures wander
+ * - Between sweeps the sketch makes its own API calls on a rotating channel
+ *   (conversion, read, status), like an application sharing the bridge
+ * - Every epoch of SWEEPS_PER_EPOCH sweeps is compared with the first:
+ *   throughput within THROUGHPUT_TOLERANCE_PCT, acquisition latency p50 at
+ *   most one histogram bucket higher and the slowest acquisition at most
+ *   one DS2482_TIMEOUT_MS wait slower, no gap between samples above
+ *   MAX_SAMPLE_GAP_MS, every conversion between its conversion time and
+ *   MAX_CONVERSION_OVERRUN_US more, at most MAX_FAILED_RECOVERIES failed
+ *   recover() calls, and free heap and stack headroom unchanged
+ *
+ * With the defaults it runs a million sweeps, about twelve virtual days, in
+ * under two minutes on a PC. A run is fully determined by FAULT_SEED. Any
+ * drift prints the epoch and the figure that moved, and the sketch ends
+ * with PASSED or FAILED.
+ *
+ * Runs on any board, but is meant for a host build; on a microcontroller
+ * lower EPOCHS. Free heap and stack headroom are measured on AVR, ESP32,
+ * ESP8266 and glibc hosts (Linux), and shown as "-" elsewhere. A host has no
+ * fixed heap, so its free heap is what is left of HOST_HEAP_BUDGET.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sampler.h"
+#include "DS2482Sim.h"
+#include "DS2482FaultBus.h"
+#include "DS2482Clock.h"
+
+const uint32_t FAULT_SEED = 4242;
+const uint16_t EPOCHS = 200;
+const uint16_t SWEEPS_PER_EPOCH = 5000;             // 40000 acquisitions, below histogram saturation
+const uint64_t START_MICROS = (0x100000000ULL - 86400000ULL) * 1000;  // One day before the millis() wrap
+const uint8_t THROUGHPUT_TOLERANCE_PCT = 2;
+const unsigned long MAX_SAMPLE_GAP_MS = 2000;       // Conversion plus the slowest recovery
+const uint32_t MAX_CONVERSION_OVERRUN_US = 2000;    // Polling granularity and transactions in flight
+const uint8_t RECOVER_AFTER = 8;                    // Consecutive failed reads before recover()
+const uint16_t DROPOUT_ODDS = 500;                  // One sensor drop-out per this many sweeps on average
+const uint8_t DROPOUT_SWEEPS = 20;                  // Sweeps a dropped sensor stays off the bus
+const uint8_t REPORT_EVERY = 10;                    // Epochs between progress lines
+const uint16_t CONVERSION_MS = 94;                  // 9-bit conversions
+const uint16_t MAX_FAILED_RECOVERIES = 8;           // Per epoch; the fault rates cause about one
+
+DS2482VirtualClock virtualClock(START_MICROS);
+DS2482Sim sim(0x18, &virtualClock);
+DS2482FaultBus faults(sim, FAULT_SEED, &virtualClock);
+DS2482 ds2482(0x18, &faults, &virtualClock);
+DS2482Sampler sampler(ds2482);
+DS2482Histogram histograms[DS2482_OP_COUNT];
+
+// Figures of one epoch
+struct Epoch {
+    uint32_t samples;
+    uint64_t elapsedMicros;     // Virtual time the epoch took
+    uint32_t p50Micros;         // Acquisition latency percentiles
+    uint32_t p99Micros;
+    uint32_t maxMicros;         // Slowest acquisition
+    uint32_t maxGapMs;          // Longest time without a sample
+    uint32_t minConversion;     // Convert T to completion, micros()
+    uint32_t maxConversion;
+    uint32_t freeHeap;
+    uint32_t stackHeadroom;
+    uint16_t failedRecoveries;  // recover() calls that found no working tier
+    bool wrapped;               // millis() wrapped during the epoch
+};
+
+Epoch baseline;
+uint32_t rng = FAULT_SEED;
+uint32_t violations = 0;
+int16_t temperatures[8];
+uint8_t droppedChannel = 8;     // Channel off the bus, 8 = none
+uint16_t dropoutLeft;           // Sweeps until it comes back
+uint8_t directChannel = 0;      // Channel of the next direct API call
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Soak Test");
+
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        temperatures[channel] = (18 + channel) * 16;
+        sim.attachSensor(channel, temperatures[channel], 9);
+    }
+    sim.setI2CClock(400000);    // Transactions advance the virtual clock
+
+    ds2482.setConversionTime(CONVERSION_MS);
+    ds2482.attachHistograms(histograms);
+    if (!ds2482.begin()) {
+        Serial.println("Failed to initialize DS2482!");
+        while (1);
+    }
+
+    faults.setRate(DS2482Fault::NACK, 20);
+    faults.setRate(DS2482Fault::CORRUPT_READ, 50);
+    faults.setRate(DS2482Fault::HOLD_BUSY, 5);
+    faults.setRate(DS2482Fault::CLEAR_PRESENCE, 50);
+    faults.setRate(DS2482Fault::STUCK_BUS, 1);
+
+    sampler.setChannels(0xFF);
+    sampler.setMaxRetries(2);
+    paintStack();
+
+    Serial.println("Epoch\tDays\tSamples/h\tp50 us\tp99 us\tMax us\tMax gap ms\tConversion us\tFailed recoveries\tFree heap\tStack headroom");
+    for (uint16_t epoch = 0; epoch < EPOCHS; epoch++) {
+        Epoch e;
+        runEpoch(&e);
+        if (epoch == 0) {
+            baseline = e;
+        }
+        bool drifted = !check(epoch, e);
+        if (epoch % REPORT_EVERY == 0 || epoch == EPOCHS - 1 || e.wrapped || drifted) {
+            printEpoch(epoch, e);
+        }
+    }
+
+    Serial.print("Recoveries: ");
+    Serial.print(ds2482.getRecoveryCount(DS2482Recovery::FAILED));
+    Serial.print(" failed, aborted calls: ");
+    Serial.println(ds2482.getAbortCount());
+    Serial.println(violations ? "FAILED" : "PASSED");
+}
+
+void loop() {
+}
+
+// Memory figures, 0 where the board gives none
+const uint8_t STACK_PAINT = 0xA5;
+
+#if defined(__AVR__)
+extern char __heap_start;
+extern char* __brkval;
+
+char* heapEnd() { return __brkval ? __brkval : &__heap_start; }
+
+// Fill the RAM between heap and stack so stackHeadroom() finds the deepest stack use
+void paintStack() {
+    char top;
+    for (char* p = heapEnd(); p < &top - 32; p++) {
+        *p = STACK_PAINT;
+    }
+}
+uint32_t stackHeadroom() {
+    char* p = heapEnd();
+    while (*(uint8_t*)p == STACK_PAINT) {
+        p++;
+    }
+    return p - heapEnd();
+}
+uint32_t freeHeap() { char top; return &top - heapEnd(); }
+#elif defined(ESP32)
+void paintStack() {}
+uint32_t stackHeadroom() { return uxTaskGetStackHighWaterMark(NULL); }
+uint32_t freeHeap() { return ESP.getFreeHeap(); }
+#elif defined(ESP8266)
+void paintStack() {}
+uint32_t stackHeadroom() { return ESP.getFreeContStack(); }
+uint32_t freeHeap() { return ESP.getFreeHeap(); }
+#elif defined(__GLIBC__)
+#include <malloc.h>
+const uint32_t HOST_STACK_PAINT_SIZE = 65536;       // Stack below setup() that is watched
+const uint32_t HOST_HEAP_BUDGET = 1048576;          // Heap the host build allows itself
+uintptr_t stackBottom;                              // Lowest painted address
+
+// Paint a stack area below setup() so stackHeadroom() finds the deepest stack use
+void paintStack() {
+    volatile uint8_t area[HOST_STACK_PAINT_SIZE];
+    for (uint32_t i = 0; i < HOST_STACK_PAINT_SIZE; i++) {
+        area[i] = STACK_PAINT;
+    }
+    stackBottom = (uintptr_t)area;
+}
+uint32_t stackHeadroom() {
+    const volatile uint8_t* painted = (const volatile uint8_t*)stackBottom;
+    uint32_t untouched = 0;
+    while (untouched < HOST_STACK_PAINT_SIZE && painted[untouched] == STACK_PAINT) {
+        untouched++;
+    }
+    return untouched;
+}
+uint32_t freeHeap() {
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+    size_t used = mallinfo2().uordblks;
+#else
+    size_t used = mallinfo().uordblks;
+#endif
+    return used < HOST_HEAP_BUDGET ? HOST_HEAP_BUDGET - used : 0;
+}
+#else
+void paintStack() {}
+uint32_t stackHeadroom() { return 0; }
+uint32_t freeHeap() { return 0; }
+#endif
+
+/**
+ * Run SWEEPS_PER_EPOCH sweeps and collect the epoch's figures
+ */
+void runEpoch(Epoch* e) {
+    ds2482.resetHistograms();
+    e->samples = 0;
+    e->maxGapMs = 0;
+    e->minConversion = 0xFFFFFFFF;
+    e->maxConversion = 0;
+    e->wrapped = false;
+
+    uint64_t start = virtualClock.getTime();
+    uint64_t lastSample = start;
+    unsigned long lastMillis = virtualClock.millis();
+    uint8_t lastChannel = 8;
+    uint16_t sweeps = 0;
+    uint16_t failedBefore = ds2482.getRecoveryCount(DS2482Recovery::FAILED);
+
+    while (sweeps < SWEEPS_PER_EPOCH) {
+        DS2482Sample sample;
+        bool sampled = sampler.update(&sample);
+
+        // A whole sweep without a reading: the bridge itself needs attention
+        if (sampler.getFailureStreak() >= RECOVER_AFTER) {
+            ds2482.recover();
+            sampler.resetFailureStreak();
+        }
+
+        unsigned long nowMillis = virtualClock.millis();
+        if (nowMillis < lastMillis) {
+            e->wrapped = true;
+        }
+        lastMillis = nowMillis;
+
+        if (!sampled) {
+            // Sleep until the sampler has work; timeouts and polls move the clock otherwise
+            virtualClock.advance(sampler.timeToNextEvent() * 1000UL);
+            continue;
+        }
+
+        uint64_t now = virtualClock.getTime();
+        uint32_t gap = (now - lastSample) / 1000;
+        if (gap > e->maxGapMs) {
+            e->maxGapMs = gap;
+        }
+        lastSample = now;
+        e->samples++;
+
+        uint32_t conversion = sample.conversionMicros();
+        if (conversion < e->minConversion) {
+            e->minConversion = conversion;
+        }
+        if (conversion > e->maxConversion) {
+            e->maxConversion = conversion;
+        }
+
+        // The sampler is idle after a sample; a lower channel means a new sweep began
+        if (sample.channel <= lastChannel && lastChannel != 8) {
+            sweeps++;
+            betweenSweeps();
+        }
+        lastChannel = sample.channel;
+    }
+
+    e->elapsedMicros = virtualClock.getTime() - start;
+    const DS2482Histogram* acquisition = ds2482.getHistogram(DS2482Op::ACQUISITION);
+    e->p50Micros = acquisition->percentileMicros(50);
+    e->p99Micros = acquisition->percentileMicros(99);
+    e->maxMicros = acquisition->maxMicros;
+    e->failedRecoveries = ds2482.getRecoveryCount(DS2482Recovery::FAILED) - failedBefore;
+    e->freeHeap = freeHeap();
+    e->stackHeadroom = stackHeadroom();
+}
+
+/**
+ * Sensor drop-outs, temperature changes and direct API calls between sweeps
+ */
+void betweenSweeps() {
+    if (droppedChannel < 8) {
+        if (--dropoutLeft == 0) {
+            sim.attachSensor(droppedChannel, temperatures[droppedChannel], 9);
+            droppedChannel = 8;
+        }
+    } else if (nextRandom() % DROPOUT_ODDS == 0) {
+        droppedChannel = nextRandom() % 8;
+        dropoutLeft = DROPOUT_SWEEPS;
+        sim.detachSensor(droppedChannel);
+    }
+
+    uint8_t channel = nextRandom() % 8;
+    temperatures[channel] += (int16_t)(nextRandom() % 3) - 1;
+    sim.setTemperature(channel, temperatures[channel]);
+
+    // One conversion and read through the driver, the way an application would
+    if (ds2482.startTemperatureConversion(directChannel)) {
+        while (!ds2482.checkConversionStatus()) {
+            virtualClock.advance(1000);
+        }
+        float temperature;
+        ds2482.readTemperature(directChannel, &temperature);
+    }
+    ds2482.readStatus();
+    directChannel = (directChannel + 1) % 8;
+}
+
+/**
+ * Compare an epoch with the baseline
+ * @return true if nothing drifted
+ */
+bool check(uint16_t epoch, const Epoch& e) {
+    uint32_t before = violations;
+
+    // Samples per virtual hour, as 64-bit products to survive long epochs
+    uint64_t rate = e.samples * 3600000000ULL / e.elapsedMicros;
+    uint64_t baseRate = baseline.samples * 3600000000ULL / baseline.elapsedMicros;
+    uint64_t tolerance = baseRate * THROUGHPUT_TOLERANCE_PCT / 100;
+    if (rate + tolerance < baseRate || rate > baseRate + tolerance) {
+        report(epoch, "throughput drifted");
+    }
+    // The percentiles are log2 buckets; the slowest acquisition is exact and
+    // may add one timed-out wait to the first epoch's
+    if (e.p50Micros > 2 * baseline.p50Micros ||
+        e.maxMicros > baseline.maxMicros + DS2482_TIMEOUT_MS * 1000UL) {
+        report(epoch, "acquisition latency grew");
+    }
+    if (e.maxGapMs > MAX_SAMPLE_GAP_MS) {
+        report(epoch, "no sample for too long");
+    }
+    if (e.minConversion < CONVERSION_MS * 1000UL ||
+        e.maxConversion > CONVERSION_MS * 1000UL + MAX_CONVERSION_OVERRUN_US) {
+        report(epoch, "conversion time out of bounds");
+    }
+    if (e.failedRecoveries > MAX_FAILED_RECOVERIES) {
+        report(epoch, "failed recoveries grew");
+    }
+    if (e.freeHeap < baseline.freeHeap || e.stackHeadroom < baseline.stackHeadroom) {
+        report(epoch, "memory use grew");
+    }
+    return violations == before;
+}
+
+/**
+ * Print one line of the epoch table
+ */
+void printEpoch(uint16_t epoch, const Epoch& e) {
+    Serial.print(epoch);
+    Serial.print("\t");
+    Serial.print((virtualClock.getTime() - START_MICROS) / 86400e6);
+    Serial.print("\t");
+    Serial.print((uint32_t)(e.samples * 3600000000ULL / e.elapsedMicros));
+    Serial.print("\t\t");
+    Serial.print(e.p50Micros);
+    Serial.print("\t");
+    Serial.print(e.p99Micros);
+    Serial.print("\t");
+    Serial.print(e.maxMicros);
+    Serial.print("\t");
+    Serial.print(e.maxGapMs);
+    Serial.print("\t\t");
+    Serial.print(e.minConversion);
+    Serial.print("-");
+    Serial.print(e.maxConversion);
+    Serial.print("\t");
+    Serial.print(e.failedRecoveries);
+    Serial.print("\t\t\t");
+    printMemory(e.freeHeap);
+    Serial.print("\t\t");
+    printMemory(e.stackHeadroom);
+    Serial.println(e.wrapped ? "\tmillis() wrapped" : "");
+}
+
+void printMemory(uint32_t bytes) {
+    if (bytes) {
+        Serial.print(bytes);
+    } else {
+        Serial.print("-");
+    }
+}
+
+/**
+ * Print a drift
+ */
+void report(uint16_t epoch, const char* message) {
+    violations++;
+    Serial.print("DRIFT epoch ");
+    Serial.print(epoch);
+    Serial.print(": ");
+    Serial.println(message);
+}
+
+/**
+ * xorshift32, identical on every platform so runs replay anywhere
+ */
+uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
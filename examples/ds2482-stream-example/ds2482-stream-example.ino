@@ -0,0 +1,131 @@
+/*
+ * APADevices - DS2482 Binary Sample Stream Example
+ *
+ * This example packs the samples of the sampling engine into compact
+ * binary frames for a radio or serial uplink:
+ * - Samples every channel once per sweep, one sweep every 5 seconds
+ * - Collects samples into a DS2482StreamEncoder frame of at most 48 bytes
+ * - Sends a frame once it holds 16 samples or no further sample fits
+ * - Prints each frame as hex, then decodes it again with DS2482StreamDecoder
+ *   the way the receiving side would
+ *
+ * DS2482Stream.h/.cpp only depend on <stdint.h>; copy them into a host tool
+ * to decode frames captured from the serial port.
+ *
+ * Hardware Setup:
+ * - Connect DS2482-800 to Arduino via I2C (SDA, SCL, VCC, GND)
+ * - Connect one DS18B20 per channel, each with a 4.7kΩ pullup resistor
+ *
+ * Set USE_SIMULATOR to 1 to run the sketch without hardware against the
+ * simulated bridge.
+ */
+
+#include <Wire.h>
+#include "DS2482.h"
+#include "DS2482Sampler.h"
+#include "DS2482Stream.h"
+
+#define USE_SIMULATOR 0
+
+#if USE_SIMULATOR
+#include "DS2482Sim.h"
+DS2482Sim sim;
+DS2482 ds2482(0x18, &sim);
+#else
+DS2482 ds2482;
+#endif
+
+const uint8_t BRIDGE_ADDRESS = 0x18;
+const uint8_t SAMPLES_PER_FRAME = 16;
+const unsigned long SWEEP_INTERVAL = 5000;
+
+DS2482Sampler sampler(ds2482);
+uint8_t frame[48];
+DS2482StreamEncoder encoder(frame, sizeof(frame));
+
+void setup() {
+    Serial.begin(9600);
+    while (!Serial) delay(10);
+
+    Serial.println("\nDS2482 Binary Sample Stream Example");
+
+#if USE_SIMULATOR
+    for (uint8_t channel = 0; channel < 8; channel++) {
+        sim.attachSensor(channel, (18 + channel) * 16);
+    }
+#endif
+
+    if (!ds2482.begin()) {
+        Serial.println("Failed to initialize DS2482!");
+        while (1);
+    }
+
+    sampler.setChannels(0xFF);
+    sampler.setInterval(SWEEP_INTERVAL);
+    encoder.begin(BRIDGE_ADDRESS);
+}
+
+void loop() {
+    DS2482Sample sample;
+    if (!sampler.update(&sample)) {
+        return;
+    }
+
+    if (!encoder.add(sample.channel, sample.timestamp, sample.value)) {
+        // Frame full: send it and start the next one with this sample
+        sendFrame();
+        encoder.add(sample.channel, sample.timestamp, sample.value);
+    }
+
+    if (encoder.getCount() >= SAMPLES_PER_FRAME) {
+        sendFrame();
+    }
+}
+
+/**
+ * Close the current frame, print it and start a new one
+ */
+void sendFrame() {
+    uint16_t length = encoder.finish();
+
+    Serial.print("\nFrame (");
+    Serial.print(length);
+    Serial.print(" bytes, ");
+    Serial.print(encoder.getCount());
+    Serial.println(" samples):");
+    for (uint16_t i = 0; i < length; i++) {
+        if (frame[i] < 0x10) Serial.print("0");
+        Serial.print(frame[i], HEX);
+        Serial.print(i % 16 == 15 ? "\n" : " ");
+    }
+    Serial.println();
+
+    printDecoded(frame, length);
+    encoder.begin(BRIDGE_ADDRESS);
+}
+
+/**
+ * Decode a frame as the receiver would and print its samples
+ */
+void printDecoded(const uint8_t* data, uint16_t length) {
+    DS2482StreamDecoder decoder;
+    if (!decoder.decode(data, length)) {
+        Serial.println("Frame damaged (CRC mismatch)");
+        return;
+    }
+
+    uint8_t channel;
+    uint32_t timestamp;
+    int16_t raw;
+    while (decoder.next(&channel, &timestamp, &raw)) {
+        Serial.print("  0x");
+        Serial.print(decoder.getBridge(), HEX);
+        Serial.print(" ch");
+        Serial.print(channel);
+        Serial.print(" @");
+        Serial.print(timestamp);
+        Serial.print(" ms: ");
+        Serial.print(raw / 16.0);
+        Serial.println(" °C");
+    }
+}